@@ -5,24 +5,240 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <time.h>
+#include <pthread.h>
+#include <sys/uio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 typedef enum {
     KMP_SUCCESS = 0,
     KMP_ERROR_NULL_POINTER,
     KMP_ERROR_EMPTY_PATTERN,
     KMP_ERROR_MEMORY_ALLOCATION,
-    KMP_ERROR_INVALID_INPUT
+    KMP_ERROR_INVALID_INPUT,
+    KMP_ERROR_CANCELLED,
+    KMP_ERROR_DEADLINE_EXCEEDED
 } KMPError;
 
+typedef enum {
+    KMP_ENGINE_LPS = 0,
+    KMP_ENGINE_DFA,
+    KMP_ENGINE_HORSPOOL,
+    KMP_ENGINE_MEMMEM,
+    KMP_ENGINE_STRONG,
+    KMP_ENGINE_AUTO
+} KMPEngine;
+
+typedef struct {
+    void* (*malloc_fn)(size_t size, void* context);
+    void* (*realloc_fn)(void* ptr, size_t size, void* context);
+    void (*free_fn)(void* ptr, void* context);
+    void* context;
+} KMPAllocator;
+
+typedef struct {
+    size_t live_bytes;
+    size_t peak_bytes;
+} KMPMemoryCounter;
+
+#define KMP_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
 typedef struct {
     char* pattern;
     int pattern_len;
     int* lps;
+    KMPEngine engine;
+    int period;
+    double entropy;
+    int text_alphabet;
+    unsigned short* dfa;
+    int* shift;
+    int* strong;
     bool is_compiled;
     size_t memory_usage;
+    KMPMemoryCounter memory;
+    int refcount;
+    pthread_mutex_t compile_lock;
 } KMPMatcher;
 
+#define KMP_OPTION_DEFERRED 0x1u
+
+typedef struct {
+    unsigned int flags;
+    KMPEngine engine;
+    const char* sample;
+    size_t sample_len;
+} KMPOptions;
+
+typedef struct {
+    int matched;
+    size_t offset;
+} KMPSearchState;
+
+#define KMP_SEARCH_POLL_BYTES 4096
+
+typedef struct {
+    int cancelled;
+} KMPCancelToken;
+
+typedef struct {
+    size_t start;
+    size_t end;
+    KMPCancelToken* cancel;
+    uint64_t deadline_ns;
+} KMPSearchOptions;
+
+typedef void (*KMPMatchCallback)(size_t position, void* user_data);
+
+typedef struct {
+    KMPMatcher* matcher;
+    KMPSearchState state;
+    KMPMatchCallback callback;
+    void* user_data;
+    size_t match_count;
+} KMPStream;
+
+#define KMP_REPLACE_IOV_MAX 1024
+
+typedef struct {
+    int fd;
+    unsigned long long bytes_written;
+} KMPOutputSink;
+
+typedef struct {
+    KMPMatcher* matcher;
+    char* replacement;
+    size_t replacement_len;
+    KMPOutputSink* sink;
+    int matched;
+    unsigned long long replacements;
+    struct iovec iov[KMP_REPLACE_IOV_MAX];
+    int iov_count;
+} KMPReplacer;
+
+typedef struct {
+    KMPMatcher* current;
+    int epoch;
+    int readers[2];
+    int writer_lock;
+} KMPMatcherSlot;
+
+typedef struct {
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+    size_t entries;
+    size_t bytes;
+    size_t byte_budget;
+} KMPCacheStats;
+
+typedef struct {
+    const char* text;
+    int text_len;
+    int* suffix_array;
+    void* mapping;
+    size_t mapping_len;
+    size_t memory_usage;
+} KMPIndex;
+
+typedef struct {
+    uint64_t* words;
+    size_t word_count;
+    size_t length;
+} KMPPackedSeq;
+
+#define KMP_POSITIONS_BLOCK 128
+
+typedef struct {
+    unsigned char* data;
+    size_t data_len;
+    size_t data_capacity;
+    size_t* block_first;
+    size_t* block_offsets;
+    size_t block_count;
+    size_t block_capacity;
+    size_t count;
+    size_t last;
+} KMPPositionList;
+
+typedef struct {
+    const KMPPositionList* list;
+    size_t index;
+    size_t offset;
+    size_t value;
+} KMPPositionIter;
+
+#define KMP_MULTI_PREFIX 16
+
+typedef struct {
+    char** patterns;
+    int* pattern_lens;
+    int pattern_count;
+    int lane_count;
+    uint64_t* masks;
+    uint64_t* start_bits;
+    uint64_t* end_bits;
+    int* bit_owner;
+    bool use_simd;
+    size_t memory_usage;
+} KMPMultiMatcher;
+
+typedef struct {
+    size_t position;
+    int pattern;
+} KMPMultiMatch;
+
+#define KMP_MAX_NUMA_NODES 64
+
+typedef struct {
+    int node_count;
+    int node_ids[KMP_MAX_NUMA_NODES];
+    int* node_cpus[KMP_MAX_NUMA_NODES];
+    int node_cpu_count[KMP_MAX_NUMA_NODES];
+} KMPTopology;
+
+typedef struct {
+    char* data;
+    size_t len;
+    size_t mapping_len;
+    size_t page_size;
+    KMPTopology topology;
+    size_t node_offsets[KMP_MAX_NUMA_NODES + 1];
+} KMPNumaText;
+
+typedef struct {
+    int node_count;
+    int node_ids[KMP_MAX_NUMA_NODES];
+    int node_threads[KMP_MAX_NUMA_NODES];
+    size_t node_bytes[KMP_MAX_NUMA_NODES];
+    uint64_t node_ns[KMP_MAX_NUMA_NODES];
+} KMPParallelStats;
+
+typedef enum {
+    KMP_COMPRESSION_AUTO,
+    KMP_COMPRESSION_NONE,
+    KMP_COMPRESSION_GZIP,
+    KMP_COMPRESSION_ZSTD
+} KMPCompression;
+
+#define KMP_RING_BUFFERS 4
+#define KMP_RING_BUFFER_SIZE (256 * 1024)
+
+#define KMP_METRICS_BUCKETS 608
+
+typedef struct {
+    unsigned long long searches;
+    unsigned long long bytes_scanned;
+    unsigned long long matches;
+    unsigned long long latency_sum_ns;
+    unsigned long long engine_calls[KMP_ENGINE_AUTO];
+    unsigned long long latency_buckets[KMP_METRICS_BUCKETS];
+} KMPMetricsSnapshot;
+
 typedef struct {
     int* positions;
     int count;
@@ -30,14 +246,164 @@ typedef struct {
 } SearchResult;
 
 KMPMatcher* kmp_create(const char* pattern);
+KMPMatcher* kmp_create_ex(const char* pattern, const KMPOptions* options);
+KMPError kmp_compile(KMPMatcher* matcher);
 void kmp_destroy(KMPMatcher* matcher);
 int kmp_search(KMPMatcher* matcher, const char* text);
 int* kmp_search_all(KMPMatcher* matcher, const char* text, int* count);
 SearchResult* kmp_search_with_stats(KMPMatcher* matcher, const char* text);
+KMPPositionList* kmp_search_all_compressed(KMPMatcher* matcher, const char* text);
+void kmp_free_result(SearchResult* result);
+
+/* All library memory comes from the installed allocator (libc by default;
+ * NULL restores it). Arrays returned by searches must be released with
+ * kmp_free(). An allocator must stay usable until every block it handed
+ * out has been freed, since each block goes back to the allocator that
+ * produced it. Counters are in requested bytes; a matcher's counter covers
+ * its tables plus search buffers until they are returned to the caller. */
+KMPError kmp_set_allocator(const KMPAllocator* allocator);
+void* kmp_malloc(size_t size);
+void* kmp_calloc(size_t count, size_t size);
+void* kmp_realloc(void* ptr, size_t size);
+void kmp_free(void* ptr);
+void* kmp_malloc_owned(KMPMemoryCounter* owner, size_t size);
+void kmp_disown(void* ptr);
+void kmp_memory_stats(KMPMemoryCounter* stats);
+void kmp_memory_reset_peak(void);
+void kmp_matcher_memory(const KMPMatcher* matcher, KMPMemoryCounter* stats);
+
+/* Off by default. When enabled, heap blocks of at least KMP_HUGE_PAGE_SIZE,
+ * the NUMA text mapping and loaded index files request huge pages to cut
+ * TLB misses; any refusal silently leaves normal pages in place. Only
+ * memory allocated or mapped after enabling is affected. */
+void kmp_huge_pages_enable(bool enabled);
+bool kmp_huge_pages_enabled(void);
+
+/* A compiled matcher is never modified by searches, so one instance can be
+ * shared by any number of threads. Per-search state lives in the caller's
+ * KMPSearchState; kmp_destroy() drops one reference. */
+KMPMatcher* kmp_retain(KMPMatcher* matcher);
+void kmp_release(KMPMatcher* matcher);
+void kmp_search_state_init(KMPSearchState* state);
+int kmp_search_chunk(KMPMatcher* matcher, KMPSearchState* state,
+                     const char* data, size_t len,
+                     KMPMatchCallback callback, void* user_data);
+
+/* Searches text[start, end) of a buffer that need not be NUL-terminated
+ * (end == 0 means len), polling the cancel token and the kmp_now_ns()
+ * deadline every KMP_SEARCH_POLL_BYTES. On KMP_ERROR_CANCELLED or
+ * KMP_ERROR_DEADLINE_EXCEEDED the matches found so far are returned and
+ * the cursor resumes the search when passed back in. */
+void kmp_cancel_token_init(KMPCancelToken* token);
+void kmp_cancel(KMPCancelToken* token);
+KMPError kmp_search_range(KMPMatcher* matcher, const char* text, size_t len,
+                          const KMPSearchOptions* options, KMPSearchState* cursor,
+                          size_t** positions, size_t* count);
+
+void kmp_slot_init(KMPMatcherSlot* slot, KMPMatcher* matcher);
+KMPMatcher* kmp_slot_acquire(KMPMatcherSlot* slot);
+void kmp_slot_publish(KMPMatcherSlot* slot, KMPMatcher* matcher);
+void kmp_slot_destroy(KMPMatcherSlot* slot);
+
+KMPStream* kmp_stream_create(KMPMatcher* matcher, KMPMatchCallback callback,
+                             void* user_data);
+void kmp_stream_destroy(KMPStream* stream);
+int kmp_append(KMPStream* stream, const char* bytes, size_t len);
+void kmp_stream_reset(KMPStream* stream);
+size_t kmp_stream_offset(const KMPStream* stream);
+
+/* Non-overlapping, leftmost find-and-replace (like sed s/p/r/g). Unchanged
+ * spans are written straight from the caller's buffer with writev; a chunk
+ * buffer may be reused as soon as kmp_replacer_feed() returns. */
+KMPReplacer* kmp_replacer_create(KMPMatcher* matcher, const char* replacement,
+                                 KMPOutputSink* sink);
+KMPError kmp_replacer_feed(KMPReplacer* replacer, const char* data, size_t len);
+KMPError kmp_replacer_finish(KMPReplacer* replacer);
+void kmp_replacer_destroy(KMPReplacer* replacer);
+long long kmp_replace_stream(KMPMatcher* matcher, int input_fd,
+                             const char* replacement, KMPOutputSink* sink);
+
+KMPMatcher* kmp_cache_get(const char* pattern, size_t len);
+void kmp_cache_set_budget(size_t bytes);
+void kmp_cache_get_stats(KMPCacheStats* stats);
+void kmp_cache_clear(void);
 
 int* compute_lps_table(const char* pattern, int pattern_len);
+const char* kmp_engine_name(KMPEngine engine);
+unsigned long long kmp_count_comparisons(KMPMatcher* matcher, const char* text, int n);
+
+KMPError kmp_build_failure_tables(const char* pattern, int pattern_len,
+                                  int* lps, int* strong);
 void optimize_lps_table(int* lps, int pattern_len);
 
+/* Suffix-array index over a fixed text. kmp_index_build() keeps a pointer
+ * to text, which must outlive the index; a loaded index maps its own copy. */
+KMPIndex* kmp_index_build(const char* text, size_t len);
+void kmp_index_destroy(KMPIndex* index);
+int kmp_index_count(const KMPIndex* index, const char* pattern, int pattern_len);
+int* kmp_index_locate(const KMPIndex* index, const char* pattern,
+                      int pattern_len, int* count);
+KMPError kmp_index_save(const KMPIndex* index, const char* path);
+KMPIndex* kmp_index_load(const char* path);
+
+KMPPackedSeq* kmp_packed_from_string(const char* bases, size_t len);
+void kmp_packed_destroy(KMPPackedSeq* seq);
+char kmp_packed_base_at(const KMPPackedSeq* seq, size_t index);
+size_t* kmp_packed_search_all(const KMPPackedSeq* text, const KMPPackedSeq* pattern,
+                              size_t* count);
+
+/* Match positions as delta-varint blocks of KMP_POSITIONS_BLOCK entries:
+ * sequential decoding through the iterator, random access by block, and a
+ * flat little-endian form for passing results between processes. */
+KMPPositionList* kmp_positions_create(void);
+void kmp_positions_destroy(KMPPositionList* list);
+KMPError kmp_positions_append(KMPPositionList* list, size_t position);
+KMPError kmp_positions_get(const KMPPositionList* list, size_t index, size_t* position);
+size_t kmp_positions_decode_block(const KMPPositionList* list, size_t block, size_t* out);
+size_t kmp_positions_memory(const KMPPositionList* list);
+void kmp_positions_iter_init(KMPPositionIter* iter, const KMPPositionList* list);
+bool kmp_positions_next(KMPPositionIter* iter, size_t* position);
+unsigned char* kmp_positions_serialize(const KMPPositionList* list, size_t* size);
+KMPPositionList* kmp_positions_deserialize(const unsigned char* buffer, size_t size);
+
+/* Searches many patterns in one pass with bit-parallel Shift-And over
+ * 64-bit lanes; the first KMP_MULTI_PREFIX bytes of each pattern are matched
+ * in the lanes (AVX2 when the CPU has it) and the rest is verified. */
+KMPMultiMatcher* kmp_multi_create(const char* const* patterns, int count);
+void kmp_multi_destroy(KMPMultiMatcher* matcher);
+KMPMultiMatch* kmp_multi_search_all(const KMPMultiMatcher* matcher, const char* text,
+                                    size_t len, size_t* count);
+bool kmp_multi_simd_available(void);
+
+/* NUMA-aware parallel scan: the text is copied into per-node slices that
+ * are first-touched by threads pinned to that node, and each node searches
+ * its slice with its own replica of the compiled tables. */
+KMPError kmp_topology_detect(KMPTopology* topology);
+void kmp_topology_free(KMPTopology* topology);
+KMPNumaText* kmp_numa_text_create(const char* source, size_t len);
+void kmp_numa_text_destroy(KMPNumaText* text);
+size_t* kmp_parallel_search_all(KMPMatcher* matcher, const KMPNumaText* text,
+                                int threads, size_t* count, KMPParallelStats* stats);
+
+/* Searches a gzip or zstd stream without writing it out: a producer thread
+ * decompresses into KMP_RING_BUFFERS slots while the caller's thread matches
+ * them, and positions are offsets in the decompressed data. zstd is only
+ * available when its headers were found at build time. */
+bool kmp_compression_supported(KMPCompression format);
+long long kmp_search_compressed(KMPMatcher* matcher, int input_fd, KMPCompression format,
+                                KMPMatchCallback callback, void* user_data);
+
+uint64_t kmp_now_ns(void);
+void kmp_metrics_enable(bool enabled);
+bool kmp_metrics_enabled(void);
+void kmp_metrics_record(KMPEngine engine, size_t bytes, size_t matches, uint64_t ns);
+void kmp_metrics_snapshot(KMPMetricsSnapshot* snapshot);
+void kmp_metrics_reset(void);
+int kmp_metrics_bucket(uint64_t ns);
+uint64_t kmp_metrics_bucket_floor(int bucket);
+uint64_t kmp_metrics_percentile(const KMPMetricsSnapshot* snapshot, double percentile);
+void kmp_metrics_write_prometheus(FILE* out);
+
 void print_lps_table(const int* lps, int len);
 double measure_time(clock_t start, clock_t end);
 bool validate_pattern(const char* pattern);
@@ -45,6 +411,11 @@ void kmp_print_stats(const KMPMatcher* matcher);
 const char* kmp_error_string(KMPError error);
 
 bool is_ascii_string(const char* str);
+/* Returns a libc malloc() copy, to be released with free(), not kmp_free(). */
 char* safe_string_copy(const char* src);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
\ No newline at end of file
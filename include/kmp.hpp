@@ -0,0 +1,240 @@
+#ifndef KMP_HPP
+#define KMP_HPP
+
+#include "kmp.h"
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string_view>
+#include <utility>
+
+namespace kmp {
+
+template <std::size_t N>
+struct fixed_string {
+    char data[N] = {};
+
+    constexpr fixed_string(const char (&str)[N]) {
+        for (std::size_t i = 0; i < N; i++) {
+            data[i] = str[i];
+        }
+    }
+
+    constexpr std::size_t size() const { return N - 1; }
+    constexpr std::string_view view() const { return {data, N - 1}; }
+};
+
+namespace detail {
+
+/* Same recurrence as kmp_build_failure_tables, evaluated at compile time. */
+template <std::size_t M>
+constexpr std::array<int, M> compute_lps(std::string_view pattern) {
+    std::array<int, M> lps{};
+    int len = 0;
+    for (std::size_t i = 1; i < M; i++) {
+        while (len > 0 && pattern[i] != pattern[len]) {
+            len = lps[len - 1];
+        }
+        if (pattern[i] == pattern[len]) {
+            len++;
+        }
+        lps[i] = len;
+    }
+    return lps;
+}
+
+inline std::string_view as_chars(std::span<const std::byte> bytes) {
+    return {reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+}
+
+}  // namespace detail
+
+/* A pattern and its failure table, borrowed from either a compile-time
+ * matcher or a compiled KMPMatcher. */
+struct pattern_ref {
+    const char* pattern;
+    const int* lps;
+    std::size_t size;
+};
+
+/* Lazy, non-allocating range of match offsets. The iterator carries the
+ * automaton state, so each increment resumes the scan where it stopped. */
+class match_range : public std::ranges::view_interface<match_range> {
+public:
+    class iterator {
+    public:
+        using value_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        constexpr iterator() = default;
+        constexpr iterator(pattern_ref ref, std::string_view text)
+            : ref_(ref), text_(text), done_(false) {
+            advance();
+        }
+
+        constexpr std::size_t operator*() const { return match_; }
+
+        constexpr iterator& operator++() {
+            advance();
+            return *this;
+        }
+
+        constexpr iterator operator++(int) {
+            iterator copy = *this;
+            advance();
+            return copy;
+        }
+
+        constexpr bool operator==(const iterator& other) const {
+            return done_ == other.done_ && (done_ || pos_ == other.pos_);
+        }
+
+        constexpr bool operator==(std::default_sentinel_t) const { return done_; }
+
+    private:
+        constexpr void advance() {
+            const int m = static_cast<int>(ref_.size);
+            while (pos_ < text_.size()) {
+                char c = text_[pos_++];
+                while (state_ > 0 && ref_.pattern[state_] != c) {
+                    state_ = ref_.lps[state_ - 1];
+                }
+                if (ref_.pattern[state_] == c) {
+                    state_++;
+                }
+                if (state_ == m) {
+                    match_ = pos_ - ref_.size;
+                    state_ = ref_.lps[m - 1];
+                    return;
+                }
+            }
+            done_ = true;
+        }
+
+        pattern_ref ref_{};
+        std::string_view text_{};
+        std::size_t pos_ = 0;
+        std::size_t match_ = 0;
+        int state_ = 0;
+        bool done_ = true;
+    };
+
+    constexpr match_range() = default;
+    constexpr match_range(pattern_ref ref, std::string_view text) : ref_(ref), text_(text) {}
+
+    constexpr iterator begin() const { return iterator(ref_, text_); }
+    constexpr std::default_sentinel_t end() const { return {}; }
+
+private:
+    pattern_ref ref_{};
+    std::string_view text_{};
+};
+
+/* A literal pattern compiled entirely at compile time: the pattern and its
+ * LPS table are static constexpr data, so construction is free and nothing
+ * is allocated. */
+template <fixed_string Pattern>
+class matcher {
+public:
+    static_assert(Pattern.size() > 0, "pattern must not be empty");
+
+    static constexpr std::size_t size = Pattern.size();
+    static constexpr fixed_string<size + 1> pattern = Pattern;
+    static constexpr std::array<int, size> lps = detail::compute_lps<size>(Pattern.view());
+
+    static constexpr pattern_ref ref() { return {pattern.data, lps.data(), size}; }
+
+    static constexpr match_range find_all(std::string_view text) { return {ref(), text}; }
+
+    static match_range find_all(std::span<const std::byte> bytes) {
+        return find_all(detail::as_chars(bytes));
+    }
+
+    static constexpr std::optional<std::size_t> find(std::string_view text) {
+        match_range matches = find_all(text);
+        auto it = matches.begin();
+        if (it == std::default_sentinel) {
+            return std::nullopt;
+        }
+        return *it;
+    }
+
+    static constexpr std::size_t count(std::string_view text) {
+        std::size_t total = 0;
+        for (auto it = find_all(text).begin(); it != std::default_sentinel; ++it) {
+            total++;
+        }
+        return total;
+    }
+};
+
+/* Owning handle for a runtime pattern. Copies share the compiled matcher
+ * through kmp_retain(); the searches are the same lazy ranges as above. */
+class dynamic_matcher {
+public:
+    explicit dynamic_matcher(const char* pattern, const KMPOptions* options = nullptr)
+        : matcher_(kmp_create_ex(pattern, options)) {
+        if (matcher_ && kmp_compile(matcher_) != KMP_SUCCESS) {
+            kmp_release(matcher_);
+            matcher_ = nullptr;
+        }
+    }
+
+    /* Takes over the caller's reference to matcher. A deferred matcher is
+     * compiled here; if that fails the reference is released and the handle
+     * is empty. */
+    explicit dynamic_matcher(KMPMatcher* matcher) : matcher_(matcher) {
+        if (matcher_ && kmp_compile(matcher_) != KMP_SUCCESS) {
+            kmp_release(matcher_);
+            matcher_ = nullptr;
+        }
+    }
+
+    dynamic_matcher(const dynamic_matcher& other) : matcher_(kmp_retain(other.matcher_)) {}
+
+    dynamic_matcher(dynamic_matcher&& other) noexcept
+        : matcher_(std::exchange(other.matcher_, nullptr)) {}
+
+    dynamic_matcher& operator=(dynamic_matcher other) noexcept {
+        std::swap(matcher_, other.matcher_);
+        return *this;
+    }
+
+    ~dynamic_matcher() { kmp_release(matcher_); }
+
+    explicit operator bool() const { return matcher_ != nullptr; }
+    KMPMatcher* get() const { return matcher_; }
+
+    pattern_ref ref() const {
+        return {matcher_->pattern, matcher_->lps, static_cast<std::size_t>(matcher_->pattern_len)};
+    }
+
+    match_range find_all(std::string_view text) const {
+        return matcher_ ? match_range(ref(), text) : match_range();
+    }
+
+    match_range find_all(std::span<const std::byte> bytes) const {
+        return find_all(detail::as_chars(bytes));
+    }
+
+    std::optional<std::size_t> find(std::string_view text) const {
+        match_range matches = find_all(text);
+        auto it = matches.begin();
+        if (it == std::default_sentinel) {
+            return std::nullopt;
+        }
+        return *it;
+    }
+
+private:
+    KMPMatcher* matcher_;
+};
+
+}  // namespace kmp
+
+#endif
@@ -0,0 +1,259 @@
+#define _GNU_SOURCE
+#include "kmp_internal.h"
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* Each block is preceded by a header holding its requested size, the
+ * allocator that produced it and the counter it is charged to, so kmp_free()
+ * can undo the accounting and return the block to the right allocator after
+ * kmp_set_allocator() has installed a different one. */
+typedef struct {
+    size_t size;
+    const KMPAllocator* allocator;
+    KMPMemoryCounter* owner;
+} BlockHeader;
+
+#define KMP_BLOCK_HEADER ((sizeof(BlockHeader) + 15) & ~(size_t)15)
+
+static void* libc_malloc(size_t size, void* context) {
+    (void)context;
+    return malloc(size);
+}
+
+static void* libc_realloc(void* ptr, size_t size, void* context) {
+    (void)context;
+    return realloc(ptr, size);
+}
+
+static void libc_free(void* ptr, void* context) {
+    (void)context;
+    free(ptr);
+}
+
+static const KMPAllocator libc_allocator = {libc_malloc, libc_realloc, libc_free, NULL};
+static const KMPAllocator* current_allocator = &libc_allocator;
+static KMPMemoryCounter global_memory;
+static bool huge_pages;
+
+static void charge(KMPMemoryCounter* counter, size_t bytes) {
+    size_t live = __atomic_add_fetch(&counter->live_bytes, bytes, __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&counter->peak_bytes, __ATOMIC_RELAXED);
+    while (live > peak &&
+           !__atomic_compare_exchange_n(&counter->peak_bytes, &peak, live, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static void discharge(KMPMemoryCounter* counter, size_t bytes) {
+    __atomic_sub_fetch(&counter->live_bytes, bytes, __ATOMIC_RELAXED);
+}
+
+static BlockHeader* header_of(void* ptr) {
+    return (BlockHeader*)((char*)ptr - KMP_BLOCK_HEADER);
+}
+
+KMPError kmp_set_allocator(const KMPAllocator* allocator) {
+    if (allocator && (!allocator->malloc_fn || !allocator->realloc_fn || !allocator->free_fn)) {
+        return KMP_ERROR_INVALID_INPUT;
+    }
+    __atomic_store_n(&current_allocator, allocator ? allocator : &libc_allocator,
+                     __ATOMIC_RELEASE);
+    return KMP_SUCCESS;
+}
+
+void* kmp_malloc_owned(KMPMemoryCounter* owner, size_t size) {
+    if (size > SIZE_MAX - KMP_BLOCK_HEADER) {
+        return NULL;
+    }
+
+    const KMPAllocator* allocator = __atomic_load_n(&current_allocator, __ATOMIC_ACQUIRE);
+    BlockHeader* header = (BlockHeader*)allocator->malloc_fn(KMP_BLOCK_HEADER + size,
+                                                             allocator->context);
+    if (!header) {
+        return NULL;
+    }
+
+    header->size = size;
+    header->allocator = allocator;
+    header->owner = owner;
+    charge(&global_memory, size);
+    if (owner) {
+        charge(owner, size);
+    }
+    if (size >= KMP_HUGE_PAGE_SIZE) {
+        kmp_advise_huge_pages(header, KMP_BLOCK_HEADER + size);
+    }
+    return (char*)header + KMP_BLOCK_HEADER;
+}
+
+void* kmp_malloc(size_t size) {
+    return kmp_malloc_owned(NULL, size);
+}
+
+void* kmp_calloc(size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    void* ptr = kmp_malloc(count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+char* kmp_strdup(const char* src) {
+    size_t len = strlen(src);
+    char* dest = (char*)kmp_malloc(len + 1);
+    if (dest) {
+        memcpy(dest, src, len + 1);
+    }
+    return dest;
+}
+
+/* The block keeps its owner and its allocator across a resize. */
+void* kmp_realloc(void* ptr, size_t size) {
+    if (!ptr) {
+        return kmp_malloc(size);
+    }
+    if (size > SIZE_MAX - KMP_BLOCK_HEADER) {
+        return NULL;
+    }
+
+    BlockHeader* header = header_of(ptr);
+    const KMPAllocator* allocator = header->allocator;
+    KMPMemoryCounter* owner = header->owner;
+    size_t old_size = header->size;
+
+    header = (BlockHeader*)allocator->realloc_fn(header, KMP_BLOCK_HEADER + size,
+                                                 allocator->context);
+    if (!header) {
+        return NULL;
+    }
+
+    header->size = size;
+    charge(&global_memory, size);
+    discharge(&global_memory, old_size);
+    if (owner) {
+        charge(owner, size);
+        discharge(owner, old_size);
+    }
+    if (size >= KMP_HUGE_PAGE_SIZE) {
+        kmp_advise_huge_pages(header, KMP_BLOCK_HEADER + size);
+    }
+    return (char*)header + KMP_BLOCK_HEADER;
+}
+
+void kmp_free(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    BlockHeader* header = header_of(ptr);
+    discharge(&global_memory, header->size);
+    if (header->owner) {
+        discharge(header->owner, header->size);
+    }
+    header->allocator->free_fn(header, header->allocator->context);
+}
+
+/* Stops charging a block to its owner, typically when a search result is
+ * handed to the caller and may outlive the matcher. */
+void kmp_disown(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    BlockHeader* header = header_of(ptr);
+    if (header->owner) {
+        discharge(header->owner, header->size);
+        header->owner = NULL;
+    }
+}
+
+static void read_counter(const KMPMemoryCounter* counter, KMPMemoryCounter* stats) {
+    stats->live_bytes = __atomic_load_n(&counter->live_bytes, __ATOMIC_RELAXED);
+    stats->peak_bytes = __atomic_load_n(&counter->peak_bytes, __ATOMIC_RELAXED);
+}
+
+void kmp_memory_stats(KMPMemoryCounter* stats) {
+    if (stats) {
+        read_counter(&global_memory, stats);
+    }
+}
+
+void kmp_memory_reset_peak(void) {
+    __atomic_store_n(&global_memory.peak_bytes,
+                     __atomic_load_n(&global_memory.live_bytes, __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+}
+
+void kmp_matcher_memory(const KMPMatcher* matcher, KMPMemoryCounter* stats) {
+    if (!stats) {
+        return;
+    }
+    if (!matcher) {
+        memset(stats, 0, sizeof(KMPMemoryCounter));
+        return;
+    }
+    read_counter(&matcher->memory, stats);
+}
+
+void kmp_huge_pages_enable(bool enabled) {
+    __atomic_store_n(&huge_pages, enabled, __ATOMIC_RELAXED);
+}
+
+bool kmp_huge_pages_enabled(void) {
+    return __atomic_load_n(&huge_pages, __ATOMIC_RELAXED);
+}
+
+/* Asks for transparent huge pages on the 2MB-aligned part of the range.
+ * Kernels without THP, or with it disabled, just refuse the advice. */
+void kmp_advise_huge_pages(void* addr, size_t len) {
+#ifdef MADV_HUGEPAGE
+    if (!kmp_huge_pages_enabled() || !addr) {
+        return;
+    }
+    uintptr_t mask = (uintptr_t)KMP_HUGE_PAGE_SIZE - 1;
+    uintptr_t start = ((uintptr_t)addr + mask) & ~mask;
+    uintptr_t end = ((uintptr_t)addr + len) & ~mask;
+    if (end > start) {
+        madvise((void*)start, end - start, MADV_HUGEPAGE);
+    }
+#else
+    (void)addr;
+    (void)len;
+#endif
+}
+
+/* Anonymous read-write mapping of at least len bytes. With huge pages
+ * enabled it first tries explicit 2MB pages, which only succeeds when the
+ * administrator has reserved them, and otherwise falls back to normal pages
+ * with the THP advice. *page_size receives the backing page size. */
+void* kmp_map_anonymous(size_t len, size_t* mapping_len, size_t* page_size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    void* mapping;
+
+#ifdef MAP_HUGETLB
+    if (kmp_huge_pages_enabled()) {
+        size_t huge_len = (len + KMP_HUGE_PAGE_SIZE - 1) / KMP_HUGE_PAGE_SIZE *
+                          KMP_HUGE_PAGE_SIZE;
+        mapping = mmap(NULL, huge_len, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mapping != MAP_FAILED) {
+            *mapping_len = huge_len;
+            *page_size = KMP_HUGE_PAGE_SIZE;
+            return mapping;
+        }
+    }
+#endif
+
+    size_t rounded = (len + page - 1) / page * page;
+    mapping = mmap(NULL, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return NULL;
+    }
+    kmp_advise_huge_pages(mapping, rounded);
+    *mapping_len = rounded;
+    *page_size = page;
+    return mapping;
+}
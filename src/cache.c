@@ -0,0 +1,314 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/kmp.h"
+#include <pthread.h>
+#include <stdint.h>
+
+#define KMP_CACHE_SHARDS 16
+#define KMP_CACHE_INITIAL_BUCKETS 64
+#define KMP_CACHE_DEFAULT_BUDGET (8u * 1024u * 1024u)
+
+typedef struct CacheEntry {
+    uint64_t hash;
+    KMPMatcher* matcher;
+    size_t bytes;
+    struct CacheEntry* chain;
+    struct CacheEntry* prev;
+    struct CacheEntry* next;
+} CacheEntry;
+
+typedef struct {
+    pthread_mutex_t lock;
+    CacheEntry** buckets;
+    size_t bucket_count;
+    size_t entries;
+    size_t bytes;
+    CacheEntry* lru_head;
+    CacheEntry* lru_tail;
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+} CacheShard;
+
+static CacheShard cache_shards[KMP_CACHE_SHARDS];
+static size_t cache_budget = KMP_CACHE_DEFAULT_BUDGET;
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+
+static void cache_init(void) {
+    for (int i = 0; i < KMP_CACHE_SHARDS; i++) {
+        memset(&cache_shards[i], 0, sizeof(CacheShard));
+        pthread_mutex_init(&cache_shards[i].lock, NULL);
+    }
+}
+
+static uint64_t cache_hash(const char* data, size_t len) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static size_t shard_budget(void) {
+    return __atomic_load_n(&cache_budget, __ATOMIC_RELAXED) / KMP_CACHE_SHARDS;
+}
+
+static void lru_unlink(CacheShard* shard, CacheEntry* entry) {
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        shard->lru_head = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        shard->lru_tail = entry->prev;
+    }
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+static void lru_push_front(CacheShard* shard, CacheEntry* entry) {
+    entry->prev = NULL;
+    entry->next = shard->lru_head;
+    if (shard->lru_head) {
+        shard->lru_head->prev = entry;
+    }
+    shard->lru_head = entry;
+    if (!shard->lru_tail) {
+        shard->lru_tail = entry;
+    }
+}
+
+static CacheEntry* shard_find(CacheShard* shard, uint64_t hash,
+                              const char* pattern, size_t len) {
+    if (!shard->buckets) {
+        return NULL;
+    }
+
+    CacheEntry* entry = shard->buckets[hash % shard->bucket_count];
+    while (entry) {
+        if (entry->hash == hash && (size_t)entry->matcher->pattern_len == len &&
+            memcmp(entry->matcher->pattern, pattern, len) == 0) {
+            return entry;
+        }
+        entry = entry->chain;
+    }
+    return NULL;
+}
+
+static void shard_remove(CacheShard* shard, CacheEntry* entry) {
+    CacheEntry** link = &shard->buckets[entry->hash % shard->bucket_count];
+    while (*link != entry) {
+        link = &(*link)->chain;
+    }
+    *link = entry->chain;
+
+    lru_unlink(shard, entry);
+    shard->entries--;
+    shard->bytes -= entry->bytes;
+}
+
+static bool shard_grow(CacheShard* shard) {
+    size_t new_count = shard->bucket_count ? shard->bucket_count * 2
+                                           : KMP_CACHE_INITIAL_BUCKETS;
+    CacheEntry** new_buckets = (CacheEntry**)kmp_calloc(new_count, sizeof(CacheEntry*));
+    if (!new_buckets) {
+        return false;
+    }
+
+    for (size_t i = 0; i < shard->bucket_count; i++) {
+        CacheEntry* entry = shard->buckets[i];
+        while (entry) {
+            CacheEntry* next = entry->chain;
+            size_t index = entry->hash % new_count;
+            entry->chain = new_buckets[index];
+            new_buckets[index] = entry;
+            entry = next;
+        }
+    }
+
+    kmp_free(shard->buckets);
+    shard->buckets = new_buckets;
+    shard->bucket_count = new_count;
+    return true;
+}
+
+/* Evicts from the LRU tail until the shard is within budget. The entries
+ * are returned chained through their now unused chain links, so that the
+ * caller can release the matchers after dropping the shard lock. */
+static CacheEntry* shard_evict(CacheShard* shard, size_t budget) {
+    CacheEntry* victims = NULL;
+    while (shard->bytes > budget && shard->lru_tail) {
+        CacheEntry* entry = shard->lru_tail;
+        shard_remove(shard, entry);
+        entry->chain = victims;
+        victims = entry;
+        shard->evictions++;
+    }
+    return victims;
+}
+
+static void release_victims(CacheEntry* victims) {
+    while (victims) {
+        CacheEntry* next = victims->chain;
+        kmp_release(victims->matcher);
+        kmp_free(victims);
+        victims = next;
+    }
+}
+
+static KMPMatcher* compile_pattern(const char* pattern, size_t len) {
+    if (len == 0 || memchr(pattern, '\0', len)) {
+        return NULL;
+    }
+
+    char* copy = (char*)kmp_malloc(len + 1);
+    if (!copy) {
+        return NULL;
+    }
+    memcpy(copy, pattern, len);
+    copy[len] = '\0';
+
+    KMPMatcher* matcher = kmp_create(copy);
+    kmp_free(copy);
+    return matcher;
+}
+
+KMPMatcher* kmp_cache_get(const char* pattern, size_t len) {
+    if (!pattern || len == 0 || len > (size_t)INT32_MAX) {
+        return NULL;
+    }
+
+    pthread_once(&cache_once, cache_init);
+
+    uint64_t hash = cache_hash(pattern, len);
+    CacheShard* shard = &cache_shards[(hash >> 32) % KMP_CACHE_SHARDS];
+
+    pthread_mutex_lock(&shard->lock);
+    CacheEntry* entry = shard_find(shard, hash, pattern, len);
+    if (entry) {
+        shard->hits++;
+        lru_unlink(shard, entry);
+        lru_push_front(shard, entry);
+        KMPMatcher* matcher = kmp_retain(entry->matcher);
+        pthread_mutex_unlock(&shard->lock);
+        return matcher;
+    }
+    shard->misses++;
+    pthread_mutex_unlock(&shard->lock);
+
+    KMPMatcher* matcher = compile_pattern(pattern, len);
+    if (!matcher) {
+        return NULL;
+    }
+
+    CacheEntry* fresh = (CacheEntry*)kmp_malloc(sizeof(CacheEntry));
+    if (!fresh) {
+        return matcher;
+    }
+    fresh->hash = hash;
+    fresh->matcher = matcher;
+    fresh->bytes = matcher->memory_usage + sizeof(CacheEntry);
+    fresh->chain = NULL;
+    fresh->prev = NULL;
+    fresh->next = NULL;
+
+    size_t budget = shard_budget();
+
+    pthread_mutex_lock(&shard->lock);
+    entry = shard_find(shard, hash, pattern, len);
+    if (entry) {
+        lru_unlink(shard, entry);
+        lru_push_front(shard, entry);
+        KMPMatcher* existing = kmp_retain(entry->matcher);
+        pthread_mutex_unlock(&shard->lock);
+        kmp_free(fresh);
+        kmp_release(matcher);
+        return existing;
+    }
+
+    if (fresh->bytes > budget ||
+        (shard->entries >= shard->bucket_count && !shard_grow(shard))) {
+        pthread_mutex_unlock(&shard->lock);
+        kmp_free(fresh);
+        return matcher;
+    }
+
+    size_t index = hash % shard->bucket_count;
+    fresh->chain = shard->buckets[index];
+    shard->buckets[index] = fresh;
+    lru_push_front(shard, fresh);
+    shard->entries++;
+    shard->bytes += fresh->bytes;
+    kmp_retain(matcher);
+
+    CacheEntry* victims = shard_evict(shard, budget);
+    pthread_mutex_unlock(&shard->lock);
+    release_victims(victims);
+
+    return matcher;
+}
+
+void kmp_cache_set_budget(size_t bytes) {
+    pthread_once(&cache_once, cache_init);
+    __atomic_store_n(&cache_budget, bytes, __ATOMIC_RELAXED);
+
+    size_t budget = bytes / KMP_CACHE_SHARDS;
+    for (int i = 0; i < KMP_CACHE_SHARDS; i++) {
+        CacheShard* shard = &cache_shards[i];
+        pthread_mutex_lock(&shard->lock);
+        CacheEntry* victims = shard_evict(shard, budget);
+        pthread_mutex_unlock(&shard->lock);
+        release_victims(victims);
+    }
+}
+
+void kmp_cache_get_stats(KMPCacheStats* stats) {
+    if (!stats) {
+        return;
+    }
+
+    pthread_once(&cache_once, cache_init);
+    memset(stats, 0, sizeof(KMPCacheStats));
+    stats->byte_budget = __atomic_load_n(&cache_budget, __ATOMIC_RELAXED);
+
+    for (int i = 0; i < KMP_CACHE_SHARDS; i++) {
+        CacheShard* shard = &cache_shards[i];
+        pthread_mutex_lock(&shard->lock);
+        stats->hits += shard->hits;
+        stats->misses += shard->misses;
+        stats->evictions += shard->evictions;
+        stats->entries += shard->entries;
+        stats->bytes += shard->bytes;
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+void kmp_cache_clear(void) {
+    pthread_once(&cache_once, cache_init);
+
+    for (int i = 0; i < KMP_CACHE_SHARDS; i++) {
+        CacheShard* shard = &cache_shards[i];
+        pthread_mutex_lock(&shard->lock);
+        CacheEntry* entry = shard->lru_head;
+        shard->lru_head = NULL;
+        shard->lru_tail = NULL;
+        kmp_free(shard->buckets);
+        shard->buckets = NULL;
+        shard->bucket_count = 0;
+        shard->entries = 0;
+        shard->bytes = 0;
+        shard->hits = 0;
+        shard->misses = 0;
+        shard->evictions = 0;
+        pthread_mutex_unlock(&shard->lock);
+
+        while (entry) {
+            CacheEntry* next = entry->next;
+            kmp_release(entry->matcher);
+            kmp_free(entry);
+            entry = next;
+        }
+    }
+}
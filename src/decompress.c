@@ -0,0 +1,375 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/kmp.h"
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef KMP_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef KMP_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define KMP_INPUT_BUFFER_SIZE (64 * 1024)
+
+/* A producer thread decompresses into a ring of KMP_RING_BUFFERS slots while
+ * the calling thread runs the matcher over filled slots, so decoding and
+ * matching overlap. The producer only writes the slot at head while fewer
+ * than KMP_RING_BUFFERS are filled; the consumer only reads the one at tail. */
+typedef struct {
+    int fd;
+    KMPCompression format;
+    unsigned char* input;
+    size_t input_len;
+    size_t input_pos;
+
+    char* slots[KMP_RING_BUFFERS];
+    size_t lens[KMP_RING_BUFFERS];
+    int head;
+    int tail;
+    int filled;
+    bool done;
+    bool failed;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} DecompressRing;
+
+static char* ring_acquire(DecompressRing* ring) {
+    pthread_mutex_lock(&ring->lock);
+    while (ring->filled == KMP_RING_BUFFERS) {
+        pthread_cond_wait(&ring->changed, &ring->lock);
+    }
+    char* slot = ring->slots[ring->head];
+    pthread_mutex_unlock(&ring->lock);
+    return slot;
+}
+
+static void ring_publish(DecompressRing* ring, size_t len) {
+    pthread_mutex_lock(&ring->lock);
+    ring->lens[ring->head] = len;
+    ring->head = (ring->head + 1) % KMP_RING_BUFFERS;
+    ring->filled++;
+    pthread_cond_broadcast(&ring->changed);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+static void ring_finish(DecompressRing* ring, bool failed) {
+    pthread_mutex_lock(&ring->lock);
+    ring->done = true;
+    ring->failed = failed;
+    pthread_cond_broadcast(&ring->changed);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+/* Returns the number of unread input bytes after refilling, 0 at end of
+ * input, or -1 on a read error. */
+static ssize_t fill_input(DecompressRing* ring) {
+    if (ring->input_pos < ring->input_len) {
+        return (ssize_t)(ring->input_len - ring->input_pos);
+    }
+
+    ssize_t got;
+    do {
+        got = read(ring->fd, ring->input, KMP_INPUT_BUFFER_SIZE);
+    } while (got < 0 && errno == EINTR);
+
+    ring->input_pos = 0;
+    ring->input_len = got > 0 ? (size_t)got : 0;
+    return got;
+}
+
+static bool produce_plain(DecompressRing* ring) {
+    for (;;) {
+        char* slot = ring_acquire(ring);
+        ssize_t available = fill_input(ring);
+        if (available < 0) {
+            return false;
+        }
+        if (available == 0) {
+            return true;
+        }
+
+        size_t len = (size_t)available < KMP_RING_BUFFER_SIZE ? (size_t)available :
+                     KMP_RING_BUFFER_SIZE;
+        memcpy(slot, ring->input + ring->input_pos, len);
+        ring->input_pos += len;
+        ring_publish(ring, len);
+    }
+}
+
+#ifdef KMP_HAVE_ZLIB
+static voidpf zlib_alloc(voidpf opaque, uInt items, uInt size) {
+    (void)opaque;
+    return kmp_calloc(items, size);
+}
+
+static void zlib_free(voidpf opaque, voidpf ptr) {
+    (void)opaque;
+    kmp_free(ptr);
+}
+
+/* Concatenated gzip members (as written by `cat a.gz b.gz`) are decoded
+ * back to back. */
+static bool produce_gzip(DecompressRing* ring) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.zalloc = zlib_alloc;
+    stream.zfree = zlib_free;
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+        return false;
+    }
+
+    bool ok = true;
+    bool finished = false;
+    char* slot = ring_acquire(ring);
+    size_t slot_len = 0;
+
+    while (slot && !finished) {
+        ssize_t available = fill_input(ring);
+        if (available <= 0) {
+            ok = available == 0 && stream.total_in == 0;
+            break;
+        }
+
+        stream.next_in = ring->input + ring->input_pos;
+        stream.avail_in = (uInt)available;
+        stream.next_out = (Bytef*)slot + slot_len;
+        stream.avail_out = (uInt)(KMP_RING_BUFFER_SIZE - slot_len);
+
+        int status = inflate(&stream, Z_NO_FLUSH);
+        ring->input_pos = ring->input_len - stream.avail_in;
+        slot_len = KMP_RING_BUFFER_SIZE - stream.avail_out;
+
+        if (status == Z_STREAM_END) {
+            if (fill_input(ring) > 0) {
+                inflateReset(&stream);
+            } else {
+                finished = true;
+            }
+        } else if (status != Z_OK && status != Z_BUF_ERROR) {
+            ok = false;
+            break;
+        }
+
+        if (slot_len == KMP_RING_BUFFER_SIZE || (finished && slot_len > 0)) {
+            ring_publish(ring, slot_len);
+            slot_len = 0;
+            slot = finished ? NULL : ring_acquire(ring);
+        }
+    }
+
+    inflateEnd(&stream);
+    return ok;
+}
+#endif
+
+#ifdef KMP_HAVE_ZSTD
+static bool produce_zstd(DecompressRing* ring) {
+    ZSTD_DStream* stream = ZSTD_createDStream();
+    if (!stream) {
+        return false;
+    }
+    ZSTD_initDStream(stream);
+
+    /* Frames are decoded back to back. A full output buffer may leave data
+     * inside the decoder, so it is drained even after the input ends. */
+    bool ok = true;
+    bool drain = false;
+    size_t pending = 0;
+    char* slot = ring_acquire(ring);
+    size_t slot_len = 0;
+
+    for (;;) {
+        ssize_t available = fill_input(ring);
+        if (available < 0) {
+            ok = false;
+            break;
+        }
+        if (available == 0 && !drain) {
+            ok = pending == 0;
+            if (slot_len > 0) {
+                ring_publish(ring, slot_len);
+            }
+            break;
+        }
+
+        ZSTD_inBuffer in = {ring->input + ring->input_pos, (size_t)available, 0};
+        ZSTD_outBuffer out = {slot, KMP_RING_BUFFER_SIZE, slot_len};
+        pending = ZSTD_decompressStream(stream, &out, &in);
+        if (ZSTD_isError(pending)) {
+            ok = false;
+            break;
+        }
+        ring->input_pos += in.pos;
+        slot_len = out.pos;
+        drain = slot_len == KMP_RING_BUFFER_SIZE;
+
+        if (slot_len == KMP_RING_BUFFER_SIZE) {
+            ring_publish(ring, slot_len);
+            slot_len = 0;
+            slot = ring_acquire(ring);
+        }
+    }
+
+    ZSTD_freeDStream(stream);
+    return ok;
+}
+#endif
+
+static void* producer_main(void* arg) {
+    DecompressRing* ring = (DecompressRing*)arg;
+    bool ok;
+
+    switch (ring->format) {
+#ifdef KMP_HAVE_ZLIB
+        case KMP_COMPRESSION_GZIP:
+            ok = produce_gzip(ring);
+            break;
+#endif
+#ifdef KMP_HAVE_ZSTD
+        case KMP_COMPRESSION_ZSTD:
+            ok = produce_zstd(ring);
+            break;
+#endif
+        case KMP_COMPRESSION_NONE:
+            ok = produce_plain(ring);
+            break;
+        default:
+            ok = false;
+            break;
+    }
+
+    ring_finish(ring, !ok);
+    return NULL;
+}
+
+bool kmp_compression_supported(KMPCompression format) {
+    switch (format) {
+        case KMP_COMPRESSION_AUTO:
+        case KMP_COMPRESSION_NONE:
+            return true;
+#ifdef KMP_HAVE_ZLIB
+        case KMP_COMPRESSION_GZIP:
+            return true;
+#endif
+#ifdef KMP_HAVE_ZSTD
+        case KMP_COMPRESSION_ZSTD:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+/* Reads the first bytes of the input (kept for the decoder) and picks the
+ * format from its magic number. */
+static KMPCompression detect_format(DecompressRing* ring) {
+    while (ring->input_len < 4) {
+        ssize_t got = read(ring->fd, ring->input + ring->input_len,
+                           KMP_INPUT_BUFFER_SIZE - ring->input_len);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            break;
+        }
+        ring->input_len += (size_t)got;
+    }
+
+    const unsigned char* p = ring->input;
+    if (ring->input_len >= 2 && p[0] == 0x1f && p[1] == 0x8b) {
+        return KMP_COMPRESSION_GZIP;
+    }
+    if (ring->input_len >= 4 && p[0] == 0x28 && p[1] == 0xb5 && p[2] == 0x2f && p[3] == 0xfd) {
+        return KMP_COMPRESSION_ZSTD;
+    }
+    return KMP_COMPRESSION_NONE;
+}
+
+/* Decompresses input_fd and feeds it through kmp_search_chunk, reporting
+ * match offsets in uncompressed coordinates. Returns the number of matches,
+ * or -1 on a read or decode error or an unsupported format; matches
+ * reported before an error have already reached the callback. */
+long long kmp_search_compressed(KMPMatcher* matcher, int input_fd, KMPCompression format,
+                                KMPMatchCallback callback, void* user_data) {
+    if (input_fd < 0 || kmp_compile(matcher) != KMP_SUCCESS) {
+        return -1;
+    }
+
+    DecompressRing ring;
+    memset(&ring, 0, sizeof(ring));
+    ring.fd = input_fd;
+    ring.input = (unsigned char*)kmp_malloc(KMP_INPUT_BUFFER_SIZE);
+    bool ok = ring.input != NULL;
+    for (int i = 0; i < KMP_RING_BUFFERS; i++) {
+        ring.slots[i] = (char*)kmp_malloc(KMP_RING_BUFFER_SIZE);
+        ok = ok && ring.slots[i];
+    }
+
+    if (ok && format == KMP_COMPRESSION_AUTO) {
+        format = detect_format(&ring);
+    }
+    ring.format = format;
+    ok = ok && kmp_compression_supported(format);
+
+    pthread_t producer;
+    ok = ok && pthread_mutex_init(&ring.lock, NULL) == 0;
+    if (ok && pthread_cond_init(&ring.changed, NULL) != 0) {
+        pthread_mutex_destroy(&ring.lock);
+        ok = false;
+    }
+    if (ok && pthread_create(&producer, NULL, producer_main, &ring) != 0) {
+        pthread_cond_destroy(&ring.changed);
+        pthread_mutex_destroy(&ring.lock);
+        ok = false;
+    }
+
+    if (!ok) {
+        for (int i = 0; i < KMP_RING_BUFFERS; i++) {
+            kmp_free(ring.slots[i]);
+        }
+        kmp_free(ring.input);
+        return -1;
+    }
+
+    KMPSearchState state;
+    kmp_search_state_init(&state);
+    long long matches = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&ring.lock);
+        while (ring.filled == 0 && !ring.done) {
+            pthread_cond_wait(&ring.changed, &ring.lock);
+        }
+        if (ring.filled == 0) {
+            pthread_mutex_unlock(&ring.lock);
+            break;
+        }
+        int slot = ring.tail;
+        pthread_mutex_unlock(&ring.lock);
+
+        int found = kmp_search_chunk(matcher, &state, ring.slots[slot], ring.lens[slot],
+                                     callback, user_data);
+        if (found > 0) {
+            matches += found;
+        }
+
+        pthread_mutex_lock(&ring.lock);
+        ring.tail = (ring.tail + 1) % KMP_RING_BUFFERS;
+        ring.filled--;
+        pthread_cond_broadcast(&ring.changed);
+        pthread_mutex_unlock(&ring.lock);
+    }
+
+    pthread_join(producer, NULL);
+    bool failed = ring.failed;
+
+    pthread_cond_destroy(&ring.changed);
+    pthread_mutex_destroy(&ring.lock);
+    for (int i = 0; i < KMP_RING_BUFFERS; i++) {
+        kmp_free(ring.slots[i]);
+    }
+    kmp_free(ring.input);
+
+    return failed ? -1 : matches;
+}
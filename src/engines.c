@@ -0,0 +1,345 @@
+#define _GNU_SOURCE
+#include "kmp_internal.h"
+#include <math.h>
+
+#define KMP_ALPHABET 128
+#define KMP_DFA_MAX_PATTERN 256
+#define KMP_DFA_MAX_ENTROPY 1.0
+
+const char* kmp_engine_name(KMPEngine engine) {
+    switch (engine) {
+        case KMP_ENGINE_LPS:
+            return "LPS-KMP";
+        case KMP_ENGINE_DFA:
+            return "DFA";
+        case KMP_ENGINE_HORSPOOL:
+            return "Horspool";
+        case KMP_ENGINE_MEMMEM:
+            return "memmem";
+        case KMP_ENGINE_STRONG:
+            return "strong-KMP";
+        case KMP_ENGINE_AUTO:
+            return "auto";
+        default:
+            return "unknown";
+    }
+}
+
+int kmp_count_alphabet(const char* text, size_t len) {
+    bool seen[256] = {false};
+    int distinct = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (!seen[c]) {
+            seen[c] = true;
+            distinct++;
+        }
+    }
+
+    return distinct;
+}
+
+double kmp_pattern_entropy(const char* pattern, int pattern_len) {
+    int counts[256] = {0};
+    double entropy = 0.0;
+
+    for (int i = 0; i < pattern_len; i++) {
+        counts[(unsigned char)pattern[i]]++;
+    }
+
+    for (int c = 0; c < 256; c++) {
+        if (counts[c] > 0) {
+            double p = (double)counts[c] / pattern_len;
+            entropy -= p * log2(p);
+        }
+    }
+
+    return entropy;
+}
+
+/* Picks an engine from the compiled LPS table, the pattern's byte entropy
+ * and the optional text sample. Highly periodic patterns produce dense
+ * overlapping matches, which restart based engines rescan, so they stay on
+ * the automaton. A text with a tiny alphabet also goes to the DFA, but only
+ * for low-entropy patterns made of that alphabet's runs: a pattern above
+ * KMP_DFA_MAX_ENTROPY bits per byte carries bytes that are rare in such a
+ * text, and memmem skips on those faster than the DFA steps. Everything else
+ * goes to memmem, which measured faster than the hand-written Horspool for
+ * every pattern length tried; Horspool and strong-KMP are only used when
+ * forced. */
+KMPEngine kmp_plan_engine(const KMPMatcher* matcher) {
+    int m = matcher->pattern_len;
+
+    if (m == 1) {
+        return KMP_ENGINE_MEMMEM;
+    }
+
+    if (matcher->period <= m / 2) {
+        return KMP_ENGINE_LPS;
+    }
+
+    if (matcher->text_alphabet > 0 && matcher->text_alphabet <= 2 &&
+        matcher->entropy <= KMP_DFA_MAX_ENTROPY) {
+        return m <= KMP_DFA_MAX_PATTERN ? KMP_ENGINE_DFA : KMP_ENGINE_LPS;
+    }
+
+    return KMP_ENGINE_MEMMEM;
+}
+
+static KMPError build_dfa(KMPMatcher* matcher) {
+    int m = matcher->pattern_len;
+    if (m > KMP_DFA_MAX_PATTERN) {
+        return KMP_ERROR_INVALID_INPUT;
+    }
+
+    size_t size = (size_t)(m + 1) * KMP_ALPHABET * sizeof(unsigned short);
+    unsigned short* dfa = (unsigned short*)kmp_malloc_owned(&matcher->memory, size);
+    if (!dfa) {
+        return KMP_ERROR_MEMORY_ALLOCATION;
+    }
+
+    const char* pattern = matcher->pattern;
+    memset(dfa, 0, KMP_ALPHABET * sizeof(unsigned short));
+    dfa[(unsigned char)pattern[0]] = 1;
+
+    for (int j = 1; j <= m; j++) {
+        const unsigned short* fallback = dfa + (size_t)matcher->lps[j - 1] * KMP_ALPHABET;
+        unsigned short* row = dfa + (size_t)j * KMP_ALPHABET;
+        memcpy(row, fallback, KMP_ALPHABET * sizeof(unsigned short));
+        if (j < m) {
+            row[(unsigned char)pattern[j]] = (unsigned short)(j + 1);
+        }
+    }
+
+    matcher->dfa = dfa;
+    return KMP_SUCCESS;
+}
+
+static KMPError build_strong(KMPMatcher* matcher) {
+    int m = matcher->pattern_len;
+    int* strong = (int*)kmp_malloc_owned(&matcher->memory, m * sizeof(int));
+    if (!strong) {
+        return KMP_ERROR_MEMORY_ALLOCATION;
+    }
+
+    /* Rewrites lps with identical values; the matcher is not published yet. */
+    kmp_build_failure_tables(matcher->pattern, m, matcher->lps, strong);
+
+    matcher->strong = strong;
+    return KMP_SUCCESS;
+}
+
+static KMPError build_shift(KMPMatcher* matcher) {
+    int m = matcher->pattern_len;
+    int* shift = (int*)kmp_malloc_owned(&matcher->memory, 256 * sizeof(int));
+    if (!shift) {
+        return KMP_ERROR_MEMORY_ALLOCATION;
+    }
+
+    for (int c = 0; c < 256; c++) {
+        shift[c] = m;
+    }
+    for (int i = 0; i < m - 1; i++) {
+        shift[(unsigned char)matcher->pattern[i]] = m - 1 - i;
+    }
+
+    matcher->shift = shift;
+    return KMP_SUCCESS;
+}
+
+KMPError kmp_build_engine(KMPMatcher* matcher) {
+    int m = matcher->pattern_len;
+    matcher->period = m - matcher->lps[m - 1];
+    matcher->entropy = kmp_pattern_entropy(matcher->pattern, m);
+
+    if (matcher->engine == KMP_ENGINE_AUTO) {
+        matcher->engine = kmp_plan_engine(matcher);
+    }
+
+    switch (matcher->engine) {
+        case KMP_ENGINE_DFA:
+            return build_dfa(matcher);
+        case KMP_ENGINE_HORSPOOL:
+            return build_shift(matcher);
+        case KMP_ENGINE_STRONG:
+            return build_strong(matcher);
+        default:
+            return KMP_SUCCESS;
+    }
+}
+
+int kmp_dfa_next(KMPMatcher* matcher, const char* text, int n, int* pos, int* state) {
+    const unsigned short* dfa = matcher->dfa;
+    int m = matcher->pattern_len;
+    int j = *state;
+
+    for (int i = *pos; i < n; i++) {
+        j = dfa[(size_t)j * KMP_ALPHABET + (unsigned char)text[i]];
+        if (j == m) {
+            *pos = i + 1;
+            *state = j;
+            return i + 1 - m;
+        }
+    }
+
+    *pos = n;
+    *state = j;
+    return -1;
+}
+
+int kmp_horspool_next(KMPMatcher* matcher, const char* text, int n, int* pos) {
+    const char* pattern = matcher->pattern;
+    const int* shift = matcher->shift;
+    int m = matcher->pattern_len;
+    char last = pattern[m - 1];
+    int i = *pos;
+
+    while (i <= n - m) {
+        unsigned char c = (unsigned char)text[i + m - 1];
+        if (c == (unsigned char)last && memcmp(text + i, pattern, m - 1) == 0) {
+            *pos = i + shift[c];
+            return i;
+        }
+        i += shift[c];
+    }
+
+    *pos = n;
+    return -1;
+}
+
+/* Classic KMP step over the plain LPS table. When comparisons is non-NULL it
+ * is advanced once per character comparison; each one either advances the
+ * text or falls back a state, so a full scan stays within 2n. */
+static inline int lps_scan(KMPMatcher* matcher, const char* text, int n, int* pos, int* state,
+                           unsigned long long* comparisons) {
+    const char* pattern = matcher->pattern;
+    const int* lps = matcher->lps;
+    int m = matcher->pattern_len;
+    int i = *pos;
+    int j = *state;
+
+    while (i < n) {
+        if (comparisons) {
+            (*comparisons)++;
+        }
+        if (pattern[j] == text[i]) {
+            i++;
+            j++;
+            if (j == m) {
+                *pos = i;
+                *state = lps[m - 1];
+                return i - m;
+            }
+        } else if (j != 0) {
+            j = lps[j - 1];
+        } else {
+            i++;
+        }
+    }
+
+    *pos = i;
+    *state = j;
+    return -1;
+}
+
+/* Period-aware KMP (Galil's rule) over the strong failure function. After a
+ * full match the pattern shifts by exactly one period, and the first
+ * m - period characters of the new window are already known to match, so
+ * the scan resumes in that state rather than re-comparing them. A mismatch
+ * never falls back to a state whose next character is the one that just
+ * failed, and state 0 jumps to the next occurrence of the first pattern
+ * character with memchr. Comparisons are counted as in lps_scan, with every
+ * byte memchr inspects counting as one. */
+static inline int strong_scan(KMPMatcher* matcher, const char* text, int n, int* pos, int* state,
+                              unsigned long long* comparisons) {
+    const char* pattern = matcher->pattern;
+    const int* strong = matcher->strong;
+    int m = matcher->pattern_len;
+    int known_prefix = m - matcher->period;
+    int i = *pos;
+    int j = *state;
+
+    while (i < n) {
+        if (j == 0) {
+            const char* hit = (const char*)memchr(text + i, pattern[0], n - i);
+            if (comparisons) {
+                *comparisons += hit ? (hit - text) - i + 1 : n - i;
+            }
+            if (!hit) {
+                i = n;
+                break;
+            }
+            i = (int)(hit - text) + 1;
+            j = 1;
+        } else {
+            if (comparisons) {
+                (*comparisons)++;
+            }
+            if (pattern[j] != text[i]) {
+                j = strong[j - 1];
+                continue;
+            }
+            i++;
+            j++;
+        }
+
+        if (j == m) {
+            *pos = i;
+            *state = known_prefix;
+            return i - m;
+        }
+    }
+
+    *pos = i;
+    *state = j;
+    return -1;
+}
+
+int kmp_lps_next(KMPMatcher* matcher, const char* text, int n, int* pos, int* state) {
+    return lps_scan(matcher, text, n, pos, state, NULL);
+}
+
+int kmp_strong_next(KMPMatcher* matcher, const char* text, int n, int* pos, int* state) {
+    return strong_scan(matcher, text, n, pos, state, NULL);
+}
+
+/* Runs a full scan through the matcher's KMP loop with its comparison
+ * counter enabled: the strong-KMP scan for that engine, the LPS-KMP scan for
+ * every other engine, whose loops are not KMP and have nothing to count. */
+unsigned long long kmp_count_comparisons(KMPMatcher* matcher, const char* text, int n) {
+    if (!text || n <= 0 || kmp_compile(matcher) != KMP_SUCCESS) {
+        return 0;
+    }
+
+    unsigned long long comparisons = 0;
+    int pos = 0;
+    int state = 0;
+
+    if (matcher->strong) {
+        while (strong_scan(matcher, text, n, &pos, &state, &comparisons) >= 0) {
+        }
+    } else {
+        while (lps_scan(matcher, text, n, &pos, &state, &comparisons) >= 0) {
+        }
+    }
+
+    return comparisons;
+}
+
+int kmp_memmem_next(KMPMatcher* matcher, const char* text, int n, int* pos) {
+    int i = *pos;
+    if (i >= n) {
+        return -1;
+    }
+
+    const char* found = (const char*)memmem(text + i, n - i, matcher->pattern,
+                                            matcher->pattern_len);
+    if (!found) {
+        *pos = n;
+        return -1;
+    }
+
+    *pos = (int)(found - text) + 1;
+    return (int)(found - text);
+}
@@ -5,32 +5,58 @@ int* compute_lps_table(const char* pattern, int pattern_len) {
         return NULL;
     }
 
-    int* lps = (int*)calloc(pattern_len, sizeof(int));
+    int* lps = (int*)kmp_malloc(pattern_len * sizeof(int));
     if (!lps) {
         return NULL;
     }
 
-    int len = 0;
-    int i = 1;
+    kmp_build_failure_tables(pattern, pattern_len, lps, NULL);
+    return lps;
+}
+
+/* Builds the plain failure function and, optionally, the strong one in a
+ * single linear pass into caller-provided buffers of pattern_len ints.
+ * strong[j - 1] is the state to fall back to on a mismatch at pattern[j]:
+ * the longest border of pattern[0..j) whose next character differs from
+ * pattern[j] (0 when there is none). strong[pattern_len - 1] is the
+ * fallback after a full match and equals lps[pattern_len - 1]. */
+KMPError kmp_build_failure_tables(const char* pattern, int pattern_len,
+                                  int* lps, int* strong) {
+    if (!pattern || !lps) {
+        return KMP_ERROR_NULL_POINTER;
+    }
 
+    if (pattern_len <= 0) {
+        return KMP_ERROR_EMPTY_PATTERN;
+    }
+
+    int len = 0;
     lps[0] = 0;
 
-    while (i < pattern_len) {
-        if (pattern[i] == pattern[len]) {
-            len++;
-            lps[i] = len;
-            i++;
-        } else {
-            if (len != 0) {
-                len = lps[len - 1];
+    for (int i = 1; i < pattern_len; i++) {
+        if (strong) {
+            int k = lps[i - 1];
+            if (pattern[k] != pattern[i]) {
+                strong[i - 1] = k;
             } else {
-                lps[i] = 0;
-                i++;
+                strong[i - 1] = (k == 0) ? 0 : strong[k - 1];
             }
         }
+
+        while (len > 0 && pattern[i] != pattern[len]) {
+            len = lps[len - 1];
+        }
+        if (pattern[i] == pattern[len]) {
+            len++;
+        }
+        lps[i] = len;
     }
 
-    return lps;
+    if (strong) {
+        strong[pattern_len - 1] = lps[pattern_len - 1];
+    }
+
+    return KMP_SUCCESS;
 }
 
 void optimize_lps_table(int* lps, int pattern_len) {
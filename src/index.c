@@ -0,0 +1,407 @@
+#define _POSIX_C_SOURCE 200809L
+#include "kmp_internal.h"
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define KMP_INDEX_MAGIC "KMPIDX01"
+
+typedef struct {
+    char magic[8];
+    uint64_t text_len;
+} IndexHeader;
+
+static size_t text_offset(void) {
+    return sizeof(IndexHeader);
+}
+
+static size_t sa_offset(size_t text_len) {
+    return (text_offset() + text_len + 7) & ~(size_t)7;
+}
+
+static void induce(const int* s, int n, int upper, const bool* ls,
+                   const int* lms, int lms_count, const int* sum_s,
+                   const int* sum_l, int* buf, int* sa) {
+    for (int i = 0; i < n; i++) {
+        sa[i] = -1;
+    }
+
+    memcpy(buf, sum_s, (upper + 1) * sizeof(int));
+    for (int i = 0; i < lms_count; i++) {
+        int d = lms[i];
+        if (d != n) {
+            sa[buf[s[d]]++] = d;
+        }
+    }
+
+    memcpy(buf, sum_l, (upper + 1) * sizeof(int));
+    sa[buf[s[n - 1]]++] = n - 1;
+    for (int i = 0; i < n; i++) {
+        int v = sa[i];
+        if (v >= 1 && !ls[v - 1]) {
+            sa[buf[s[v - 1]]++] = v - 1;
+        }
+    }
+
+    memcpy(buf, sum_l, (upper + 1) * sizeof(int));
+    for (int i = n - 1; i >= 0; i--) {
+        int v = sa[i];
+        if (v >= 1 && ls[v - 1]) {
+            sa[--buf[s[v - 1] + 1]] = v - 1;
+        }
+    }
+}
+
+/* SA-IS (Nong, Zhang and Chan): linear-time suffix sorting of s[0..n) with
+ * symbols in [0, upper]. Returns false only on allocation failure. */
+static bool sa_is(const int* s, int n, int upper, int* sa) {
+    if (n == 0) {
+        return true;
+    }
+    if (n == 1) {
+        sa[0] = 0;
+        return true;
+    }
+    if (n == 2) {
+        sa[0] = s[0] < s[1] ? 0 : 1;
+        sa[1] = 1 - sa[0];
+        return true;
+    }
+
+    bool ok = false;
+    int m = 0;
+    bool* ls = (bool*)kmp_calloc(n, sizeof(bool));
+    int* sum_s = (int*)kmp_calloc(upper + 2, sizeof(int));
+    int* sum_l = (int*)kmp_calloc(upper + 2, sizeof(int));
+    int* buf = (int*)kmp_malloc((upper + 2) * sizeof(int));
+    int* lms_map = (int*)kmp_malloc((n + 1) * sizeof(int));
+    int* lms = NULL;
+    int* sorted_lms = NULL;
+    int* rec_s = NULL;
+    int* rec_sa = NULL;
+
+    if (!ls || !sum_s || !sum_l || !buf || !lms_map) {
+        goto cleanup;
+    }
+
+    for (int i = n - 2; i >= 0; i--) {
+        ls[i] = (s[i] == s[i + 1]) ? ls[i + 1] : (s[i] < s[i + 1]);
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (!ls[i]) {
+            sum_s[s[i]]++;
+        } else {
+            sum_l[s[i] + 1]++;
+        }
+    }
+    for (int i = 0; i <= upper; i++) {
+        sum_s[i] += sum_l[i];
+        if (i < upper) {
+            sum_l[i + 1] += sum_s[i];
+        }
+    }
+
+    for (int i = 0; i <= n; i++) {
+        lms_map[i] = -1;
+    }
+    for (int i = 1; i < n; i++) {
+        if (!ls[i - 1] && ls[i]) {
+            lms_map[i] = m++;
+        }
+    }
+
+    lms = (int*)kmp_calloc(m ? m : 1, sizeof(int));
+    if (!lms) {
+        goto cleanup;
+    }
+    for (int i = 1, k = 0; i < n; i++) {
+        if (!ls[i - 1] && ls[i]) {
+            lms[k++] = i;
+        }
+    }
+
+    induce(s, n, upper, ls, lms, m, sum_s, sum_l, buf, sa);
+
+    if (m) {
+        sorted_lms = (int*)kmp_malloc(m * sizeof(int));
+        rec_s = (int*)kmp_malloc(m * sizeof(int));
+        rec_sa = (int*)kmp_malloc(m * sizeof(int));
+        if (!sorted_lms || !rec_s || !rec_sa) {
+            goto cleanup;
+        }
+
+        for (int i = 0, k = 0; i < n; i++) {
+            if (lms_map[sa[i]] != -1) {
+                sorted_lms[k++] = sa[i];
+            }
+        }
+
+        int rec_upper = 0;
+        rec_s[lms_map[sorted_lms[0]]] = 0;
+        for (int i = 1; i < m; i++) {
+            int l = sorted_lms[i - 1];
+            int r = sorted_lms[i];
+            int end_l = (lms_map[l] + 1 < m) ? lms[lms_map[l] + 1] : n;
+            int end_r = (lms_map[r] + 1 < m) ? lms[lms_map[r] + 1] : n;
+            bool same = true;
+            if (end_l - l != end_r - r) {
+                same = false;
+            } else {
+                while (l < end_l && s[l] == s[r]) {
+                    l++;
+                    r++;
+                }
+                if (l == n || r == n || s[l] != s[r]) {
+                    same = false;
+                }
+            }
+            if (!same) {
+                rec_upper++;
+            }
+            rec_s[lms_map[sorted_lms[i]]] = rec_upper;
+        }
+
+        if (!sa_is(rec_s, m, rec_upper, rec_sa)) {
+            goto cleanup;
+        }
+        for (int i = 0; i < m; i++) {
+            sorted_lms[i] = lms[rec_sa[i]];
+        }
+        induce(s, n, upper, ls, sorted_lms, m, sum_s, sum_l, buf, sa);
+    }
+
+    ok = true;
+
+cleanup:
+    kmp_free(ls);
+    kmp_free(sum_s);
+    kmp_free(sum_l);
+    kmp_free(buf);
+    kmp_free(lms_map);
+    kmp_free(lms);
+    kmp_free(sorted_lms);
+    kmp_free(rec_s);
+    kmp_free(rec_sa);
+    return ok;
+}
+
+KMPIndex* kmp_index_build(const char* text, size_t len) {
+    if (!text || len == 0 || len > (size_t)INT_MAX) {
+        return NULL;
+    }
+
+    int n = (int)len;
+    KMPIndex* index = (KMPIndex*)kmp_calloc(1, sizeof(KMPIndex));
+    int* symbols = (int*)kmp_malloc(len * sizeof(int));
+    int* sa = (int*)kmp_malloc(len * sizeof(int));
+    if (!index || !symbols || !sa) {
+        kmp_free(index);
+        kmp_free(symbols);
+        kmp_free(sa);
+        return NULL;
+    }
+
+    for (int i = 0; i < n; i++) {
+        symbols[i] = (unsigned char)text[i];
+    }
+
+    bool ok = sa_is(symbols, n, 255, sa);
+    kmp_free(symbols);
+    if (!ok) {
+        kmp_free(index);
+        kmp_free(sa);
+        return NULL;
+    }
+
+    index->text = text;
+    index->text_len = n;
+    index->suffix_array = sa;
+    index->memory_usage = sizeof(KMPIndex) + len * sizeof(int);
+    return index;
+}
+
+void kmp_index_destroy(KMPIndex* index) {
+    if (!index) {
+        return;
+    }
+
+    if (index->mapping) {
+        munmap(index->mapping, index->mapping_len);
+    } else {
+        kmp_free(index->suffix_array);
+    }
+    kmp_free(index);
+}
+
+/* Compares the pattern with the first pattern_len bytes of a suffix; a suffix
+ * that is a proper prefix of the pattern sorts before it. */
+static int compare_suffix(const KMPIndex* index, int suffix,
+                          const char* pattern, int pattern_len) {
+    int available = index->text_len - suffix;
+    int len = available < pattern_len ? available : pattern_len;
+    int cmp = memcmp(index->text + suffix, pattern, len);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return len < pattern_len ? -1 : 0;
+}
+
+static void suffix_range(const KMPIndex* index, const char* pattern,
+                         int pattern_len, int* first, int* last) {
+    int lo = 0;
+    int hi = index->text_len;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (compare_suffix(index, index->suffix_array[mid], pattern, pattern_len) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *first = lo;
+
+    hi = index->text_len;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (compare_suffix(index, index->suffix_array[mid], pattern, pattern_len) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *last = lo;
+}
+
+int kmp_index_count(const KMPIndex* index, const char* pattern, int pattern_len) {
+    if (!index || !pattern || pattern_len <= 0) {
+        return 0;
+    }
+
+    int first, last;
+    suffix_range(index, pattern, pattern_len, &first, &last);
+    return last - first;
+}
+
+static int compare_int(const void* a, const void* b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+int* kmp_index_locate(const KMPIndex* index, const char* pattern,
+                      int pattern_len, int* count) {
+    if (!count) {
+        return NULL;
+    }
+    *count = 0;
+
+    if (!index || !pattern || pattern_len <= 0) {
+        return NULL;
+    }
+
+    int first, last;
+    suffix_range(index, pattern, pattern_len, &first, &last);
+    if (last == first) {
+        return NULL;
+    }
+
+    int* positions = (int*)kmp_malloc((last - first) * sizeof(int));
+    if (!positions) {
+        return NULL;
+    }
+
+    memcpy(positions, index->suffix_array + first, (last - first) * sizeof(int));
+    qsort(positions, last - first, sizeof(int), compare_int);
+    *count = last - first;
+    return positions;
+}
+
+KMPError kmp_index_save(const KMPIndex* index, const char* path) {
+    if (!index || !path) {
+        return KMP_ERROR_NULL_POINTER;
+    }
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return KMP_ERROR_INVALID_INPUT;
+    }
+
+    IndexHeader header;
+    memcpy(header.magic, KMP_INDEX_MAGIC, sizeof(header.magic));
+    header.text_len = (uint64_t)index->text_len;
+
+    size_t padding = sa_offset(index->text_len) - text_offset() - index->text_len;
+    static const char zeros[8] = {0};
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(index->text, 1, index->text_len, file) == (size_t)index->text_len &&
+              fwrite(zeros, 1, padding, file) == padding &&
+              fwrite(index->suffix_array, sizeof(int), index->text_len, file) ==
+                  (size_t)index->text_len;
+
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    return ok ? KMP_SUCCESS : KMP_ERROR_INVALID_INPUT;
+}
+
+KMPIndex* kmp_index_load(const char* path) {
+    if (!path) {
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(IndexHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return NULL;
+    }
+    kmp_advise_huge_pages(mapping, size);
+
+    const IndexHeader* header = (const IndexHeader*)mapping;
+    uint64_t n = header->text_len;
+    if (memcmp(header->magic, KMP_INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+        n == 0 || n > (uint64_t)INT_MAX ||
+        sa_offset((size_t)n) + (size_t)n * sizeof(int) != size) {
+        munmap(mapping, size);
+        return NULL;
+    }
+
+    /* Searches index the text with these entries, so a corrupt file must
+     * not get past here with one pointing outside it. */
+    const int* suffix_array = (const int*)((char*)mapping + sa_offset((size_t)n));
+    for (uint64_t i = 0; i < n; i++) {
+        if (suffix_array[i] < 0 || (uint64_t)suffix_array[i] >= n) {
+            munmap(mapping, size);
+            return NULL;
+        }
+    }
+
+    KMPIndex* index = (KMPIndex*)kmp_calloc(1, sizeof(KMPIndex));
+    if (!index) {
+        munmap(mapping, size);
+        return NULL;
+    }
+
+    index->text = (const char*)mapping + text_offset();
+    index->text_len = (int)n;
+    index->suffix_array = (int*)((char*)mapping + sa_offset((size_t)n));
+    index->mapping = mapping;
+    index->mapping_len = size;
+    index->memory_usage = sizeof(KMPIndex);
+    return index;
+}
@@ -1,6 +1,10 @@
-#include "../include/kmp.h"
+#include "kmp_internal.h"
 
 KMPMatcher* kmp_create(const char* pattern) {
+    return kmp_create_ex(pattern, NULL);
+}
+
+KMPMatcher* kmp_create_ex(const char* pattern, const KMPOptions* options) {
     if (!pattern) {
         return NULL;
     }
@@ -14,43 +18,298 @@ KMPMatcher* kmp_create(const char* pattern) {
         return NULL;
     }
 
-    KMPMatcher* matcher = (KMPMatcher*)malloc(sizeof(KMPMatcher));
+    KMPMatcher* matcher = (KMPMatcher*)kmp_malloc(sizeof(KMPMatcher));
     if (!matcher) {
         return NULL;
     }
 
-    matcher->pattern = safe_string_copy(pattern);
+    matcher->memory.live_bytes = 0;
+    matcher->memory.peak_bytes = 0;
+    matcher->pattern = (char*)kmp_malloc_owned(&matcher->memory, pattern_len + 1);
     if (!matcher->pattern) {
-        free(matcher);
+        kmp_free(matcher);
         return NULL;
     }
+    memcpy(matcher->pattern, pattern, pattern_len + 1);
 
     matcher->pattern_len = pattern_len;
-    matcher->lps = compute_lps_table(pattern, pattern_len);
-    if (!matcher->lps) {
-        free(matcher->pattern);
-        free(matcher);
-        return NULL;
+    matcher->lps = NULL;
+    matcher->engine = options ? options->engine : KMP_ENGINE_LPS;
+    matcher->period = 0;
+    matcher->entropy = 0.0;
+    matcher->text_alphabet = 0;
+    matcher->dfa = NULL;
+    matcher->shift = NULL;
+    matcher->strong = NULL;
+    matcher->is_compiled = false;
+    matcher->memory_usage = sizeof(KMPMatcher) + matcher->memory.live_bytes;
+    matcher->refcount = 1;
+    pthread_mutex_init(&matcher->compile_lock, NULL);
+
+    if (matcher->engine == KMP_ENGINE_AUTO && options->sample) {
+        matcher->text_alphabet = kmp_count_alphabet(options->sample, options->sample_len);
     }
 
-    matcher->is_compiled = true;
-    matcher->memory_usage = sizeof(KMPMatcher) +
-                           (pattern_len + 1) * sizeof(char) +
-                           pattern_len * sizeof(int);
+    if (options && (options->flags & KMP_OPTION_DEFERRED)) {
+        return matcher;
+    }
+
+    if (kmp_compile(matcher) != KMP_SUCCESS) {
+        kmp_release(matcher);
+        return NULL;
+    }
 
     return matcher;
 }
 
+/* Builds the search tables once. Safe to call from many threads: the first
+ * caller compiles under compile_lock, the rest only see is_compiled set. */
+KMPError kmp_compile(KMPMatcher* matcher) {
+    if (!matcher) {
+        return KMP_ERROR_NULL_POINTER;
+    }
+
+    if (__atomic_load_n(&matcher->is_compiled, __ATOMIC_ACQUIRE)) {
+        return KMP_SUCCESS;
+    }
+
+    KMPError error = KMP_SUCCESS;
+    pthread_mutex_lock(&matcher->compile_lock);
+    if (!matcher->is_compiled) {
+        matcher->lps = (int*)kmp_malloc_owned(&matcher->memory,
+                                              matcher->pattern_len * sizeof(int));
+        if (matcher->lps) {
+            kmp_build_failure_tables(matcher->pattern, matcher->pattern_len, matcher->lps, NULL);
+            error = kmp_build_engine(matcher);
+        } else {
+            error = KMP_ERROR_MEMORY_ALLOCATION;
+        }
+        if (error == KMP_SUCCESS) {
+            matcher->memory_usage = sizeof(KMPMatcher) + matcher->memory.live_bytes;
+            __atomic_store_n(&matcher->is_compiled, true, __ATOMIC_RELEASE);
+        } else if (matcher->lps) {
+            kmp_free(matcher->lps);
+            matcher->lps = NULL;
+        }
+    }
+    pthread_mutex_unlock(&matcher->compile_lock);
+
+    return error;
+}
+
 void kmp_destroy(KMPMatcher* matcher) {
+    kmp_release(matcher);
+}
+
+KMPMatcher* kmp_retain(KMPMatcher* matcher) {
     if (matcher) {
-        free(matcher->pattern);
-        free(matcher->lps);
-        free(matcher);
+        __atomic_fetch_add(&matcher->refcount, 1, __ATOMIC_RELAXED);
+    }
+    return matcher;
+}
+
+void kmp_release(KMPMatcher* matcher) {
+    if (!matcher) {
+        return;
+    }
+
+    if (__atomic_sub_fetch(&matcher->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        pthread_mutex_destroy(&matcher->compile_lock);
+        kmp_free(matcher->pattern);
+        kmp_free(matcher->lps);
+        kmp_free(matcher->dfa);
+        kmp_free(matcher->shift);
+        kmp_free(matcher->strong);
+        kmp_free(matcher);
+    }
+}
+
+void kmp_search_state_init(KMPSearchState* state) {
+    if (state) {
+        state->matched = 0;
+        state->offset = 0;
+    }
+}
+
+static int scan_chunk(const KMPMatcher* matcher, KMPSearchState* state,
+                      const char* data, size_t len,
+                      KMPMatchCallback callback, void* user_data) {
+    const char* pattern = matcher->pattern;
+    const int* lps = matcher->lps;
+    int m = matcher->pattern_len;
+    int j = state->matched;
+    int found = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+        while (j > 0 && pattern[j] != c) {
+            j = lps[j - 1];
+        }
+        if (pattern[j] == c) {
+            j++;
+        }
+        if (j == m) {
+            found++;
+            if (callback) {
+                callback(state->offset + i + 1 - m, user_data);
+            }
+            j = lps[m - 1];
+        }
+    }
+
+    state->matched = j;
+    state->offset += len;
+    return found;
+}
+
+int kmp_search_chunk(KMPMatcher* matcher, KMPSearchState* state,
+                     const char* data, size_t len,
+                     KMPMatchCallback callback, void* user_data) {
+    if (!state || (!data && len > 0) || kmp_compile(matcher) != KMP_SUCCESS) {
+        return -1;
+    }
+
+    uint64_t start = kmp_metrics_enabled() ? kmp_now_ns() : 0;
+    int found = scan_chunk(matcher, state, data, len, callback, user_data);
+
+    if (start) {
+        kmp_metrics_record(KMP_ENGINE_LPS, len, found, kmp_now_ns() - start);
+    }
+    return found;
+}
+
+void kmp_cancel_token_init(KMPCancelToken* token) {
+    if (token) {
+        __atomic_store_n(&token->cancelled, 0, __ATOMIC_RELEASE);
+    }
+}
+
+void kmp_cancel(KMPCancelToken* token) {
+    if (token) {
+        __atomic_store_n(&token->cancelled, 1, __ATOMIC_RELEASE);
+    }
+}
+
+typedef struct {
+    KMPMemoryCounter* owner;
+    size_t* positions;
+    size_t count;
+    size_t capacity;
+    bool failed;
+} PositionList;
+
+static void collect_position(size_t position, void* user_data) {
+    PositionList* list = (PositionList*)user_data;
+    if (list->failed) {
+        return;
+    }
+
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 16;
+        size_t* grown = list->positions ?
+                        (size_t*)kmp_realloc(list->positions, capacity * sizeof(size_t)) :
+                        (size_t*)kmp_malloc_owned(list->owner, capacity * sizeof(size_t));
+        if (!grown) {
+            list->failed = true;
+            return;
+        }
+        list->positions = grown;
+        list->capacity = capacity;
+    }
+    list->positions[list->count++] = position;
+}
+
+static KMPError poll_search(const KMPSearchOptions* options) {
+    if (options->cancel && __atomic_load_n(&options->cancel->cancelled, __ATOMIC_ACQUIRE)) {
+        return KMP_ERROR_CANCELLED;
+    }
+    if (options->deadline_ns && kmp_now_ns() >= options->deadline_ns) {
+        return KMP_ERROR_DEADLINE_EXCEEDED;
+    }
+    return KMP_SUCCESS;
+}
+
+KMPError kmp_search_range(KMPMatcher* matcher, const char* text, size_t len,
+                          const KMPSearchOptions* options, KMPSearchState* cursor,
+                          size_t** positions, size_t* count) {
+    if (!positions || !count) {
+        return KMP_ERROR_NULL_POINTER;
+    }
+    *positions = NULL;
+    *count = 0;
+
+    if (!text || !cursor) {
+        return KMP_ERROR_NULL_POINTER;
+    }
+
+    KMPError error = kmp_compile(matcher);
+    if (error != KMP_SUCCESS) {
+        return error;
+    }
+
+    KMPSearchOptions defaults = {0, 0, NULL, 0};
+    if (!options) {
+        options = &defaults;
+    }
+
+    size_t end = (options->end == 0 || options->end > len) ? len : options->end;
+    if (options->start > end) {
+        return KMP_ERROR_INVALID_INPUT;
+    }
+    if (cursor->offset < options->start || cursor->offset > end) {
+        cursor->matched = 0;
+        cursor->offset = options->start;
+    }
+
+    uint64_t start = kmp_metrics_enabled() ? kmp_now_ns() : 0;
+    size_t first = cursor->offset;
+    PositionList list = {&matcher->memory, NULL, 0, 0, false};
+
+    while (cursor->offset < end) {
+        error = poll_search(options);
+        if (error != KMP_SUCCESS) {
+            break;
+        }
+
+        size_t slice = end - cursor->offset;
+        if (slice > KMP_SEARCH_POLL_BYTES) {
+            slice = KMP_SEARCH_POLL_BYTES;
+        }
+        scan_chunk(matcher, cursor, text + cursor->offset, slice, collect_position, &list);
+        if (list.failed) {
+            kmp_free(list.positions);
+            return KMP_ERROR_MEMORY_ALLOCATION;
+        }
+    }
+
+    if (start) {
+        kmp_metrics_record(KMP_ENGINE_LPS, cursor->offset - first, list.count,
+                           kmp_now_ns() - start);
+    }
+
+    kmp_disown(list.positions);
+    *positions = list.positions;
+    *count = list.count;
+    return error;
+}
+
+static int engine_next(KMPMatcher* matcher, const char* text, int n, int* pos, int* state) {
+    switch (matcher->engine) {
+        case KMP_ENGINE_DFA:
+            return kmp_dfa_next(matcher, text, n, pos, state);
+        case KMP_ENGINE_HORSPOOL:
+            return kmp_horspool_next(matcher, text, n, pos);
+        case KMP_ENGINE_MEMMEM:
+            return kmp_memmem_next(matcher, text, n, pos);
+        case KMP_ENGINE_STRONG:
+            return kmp_strong_next(matcher, text, n, pos, state);
+        default:
+            return kmp_lps_next(matcher, text, n, pos, state);
     }
 }
 
 int kmp_search(KMPMatcher* matcher, const char* text) {
-    if (!matcher || !matcher->is_compiled || !text) {
+    if (!text || kmp_compile(matcher) != KMP_SUCCESS) {
         return -1;
     }
 
@@ -59,32 +318,22 @@ int kmp_search(KMPMatcher* matcher, const char* text) {
     }
 
     int n = strlen(text);
-    int m = matcher->pattern_len;
     int i = 0;
     int j = 0;
 
-    while (i < n) {
-        if (matcher->pattern[j] == text[i]) {
-            i++;
-            j++;
-        }
-
-        if (j == m) {
-            return i - j;
-        } else if (i < n && matcher->pattern[j] != text[i]) {
-            if (j != 0) {
-                j = matcher->lps[j - 1];
-            } else {
-                i++;
-            }
-        }
+    if (!kmp_metrics_enabled()) {
+        return engine_next(matcher, text, n, &i, &j);
     }
 
-    return -1;
+    uint64_t start = kmp_now_ns();
+    int position = engine_next(matcher, text, n, &i, &j);
+    kmp_metrics_record(matcher->engine, position >= 0 ? (size_t)i : (size_t)n,
+                       position >= 0, kmp_now_ns() - start);
+    return position;
 }
 
 int* kmp_search_all(KMPMatcher* matcher, const char* text, int* count) {
-    if (!matcher || !matcher->is_compiled || !text || !count) {
+    if (!text || !count || kmp_compile(matcher) != KMP_SUCCESS) {
         if (count) *count = 0;
         return NULL;
     }
@@ -95,9 +344,9 @@ int* kmp_search_all(KMPMatcher* matcher, const char* text, int* count) {
     }
 
     int n = strlen(text);
-    int m = matcher->pattern_len;
+    uint64_t start = kmp_metrics_enabled() ? kmp_now_ns() : 0;
     int capacity = 10;
-    int* positions = (int*)malloc(capacity * sizeof(int));
+    int* positions = (int*)kmp_malloc_owned(&matcher->memory, capacity * sizeof(int));
     if (!positions) {
         *count = 0;
         return NULL;
@@ -106,52 +355,78 @@ int* kmp_search_all(KMPMatcher* matcher, const char* text, int* count) {
     *count = 0;
     int i = 0;
     int j = 0;
+    int position;
 
-    while (i < n) {
-        if (matcher->pattern[j] == text[i]) {
-            i++;
-            j++;
+    while ((position = engine_next(matcher, text, n, &i, &j)) >= 0) {
+        if (*count >= capacity) {
+            capacity *= 2;
+            int* new_positions = (int*)kmp_realloc(positions, capacity * sizeof(int));
+            if (!new_positions) {
+                kmp_free(positions);
+                *count = 0;
+                return NULL;
+            }
+            positions = new_positions;
         }
 
-        if (j == m) {
-            if (*count >= capacity) {
-                capacity *= 2;
-                int* new_positions = (int*)realloc(positions, capacity * sizeof(int));
-                if (!new_positions) {
-                    free(positions);
-                    *count = 0;
-                    return NULL;
-                }
-                positions = new_positions;
-            }
+        positions[*count] = position;
+        (*count)++;
+    }
 
-            positions[*count] = i - j;
-            (*count)++;
-            j = matcher->lps[j - 1];
-        } else if (i < n && matcher->pattern[j] != text[i]) {
-            if (j != 0) {
-                j = matcher->lps[j - 1];
-            } else {
-                i++;
-            }
-        }
+    if (start) {
+        kmp_metrics_record(matcher->engine, n, *count, kmp_now_ns() - start);
     }
 
     if (*count == 0) {
-        free(positions);
+        kmp_free(positions);
+        return NULL;
+    }
+
+    int* result = (int*)kmp_realloc(positions, (*count) * sizeof(int));
+    if (!result) {
+        result = positions;
+    }
+    kmp_disown(result);
+    return result;
+}
+
+/* Same scan as kmp_search_all, but positions are encoded as they are found,
+ * so a frequent pattern never materialises a flat int array. */
+KMPPositionList* kmp_search_all_compressed(KMPMatcher* matcher, const char* text) {
+    if (!text || kmp_compile(matcher) != KMP_SUCCESS || !is_ascii_string(text)) {
+        return NULL;
+    }
+
+    KMPPositionList* list = kmp_positions_create();
+    if (!list) {
         return NULL;
     }
 
-    int* result = (int*)realloc(positions, (*count) * sizeof(int));
-    return result ? result : positions;
+    int n = strlen(text);
+    uint64_t start = kmp_metrics_enabled() ? kmp_now_ns() : 0;
+    int i = 0;
+    int j = 0;
+    int position;
+
+    while ((position = engine_next(matcher, text, n, &i, &j)) >= 0) {
+        if (kmp_positions_append(list, (size_t)position) != KMP_SUCCESS) {
+            kmp_positions_destroy(list);
+            return NULL;
+        }
+    }
+
+    if (start) {
+        kmp_metrics_record(matcher->engine, n, list->count, kmp_now_ns() - start);
+    }
+    return list;
 }
 
 SearchResult* kmp_search_with_stats(KMPMatcher* matcher, const char* text) {
-    if (!matcher || !matcher->is_compiled || !text) {
+    if (!text || kmp_compile(matcher) != KMP_SUCCESS) {
         return NULL;
     }
 
-    SearchResult* result = (SearchResult*)malloc(sizeof(SearchResult));
+    SearchResult* result = (SearchResult*)kmp_malloc(sizeof(SearchResult));
     if (!result) {
         return NULL;
     }
@@ -163,4 +438,11 @@ SearchResult* kmp_search_with_stats(KMPMatcher* matcher, const char* text) {
     result->search_time = measure_time(start, end);
 
     return result;
-}
\ No newline at end of file
+}
+
+void kmp_free_result(SearchResult* result) {
+    if (result) {
+        kmp_free(result->positions);
+        kmp_free(result);
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef KMP_INTERNAL_H
+#define KMP_INTERNAL_H
+
+#include "../include/kmp.h"
+
+/* Engine planning and the per-engine scan steps behind kmp_search(). These
+ * operate on a compiled matcher's private tables and are not part of the
+ * public API; callers choose an engine through KMPOptions.engine. */
+int kmp_count_alphabet(const char* text, size_t len);
+double kmp_pattern_entropy(const char* pattern, int pattern_len);
+KMPEngine kmp_plan_engine(const KMPMatcher* matcher);
+KMPError kmp_build_engine(KMPMatcher* matcher);
+int kmp_lps_next(KMPMatcher* matcher, const char* text, int n, int* pos, int* state);
+int kmp_dfa_next(KMPMatcher* matcher, const char* text, int n, int* pos, int* state);
+int kmp_horspool_next(KMPMatcher* matcher, const char* text, int n, int* pos);
+int kmp_memmem_next(KMPMatcher* matcher, const char* text, int n, int* pos);
+int kmp_strong_next(KMPMatcher* matcher, const char* text, int n, int* pos, int* state);
+
+/* Copies a string into a kmp_malloc() block, for strings the library owns. */
+char* kmp_strdup(const char* src);
+
+/* Huge page backing used by the allocator, the NUMA text and loaded index
+ * files; both honour kmp_huge_pages_enabled(). */
+void kmp_advise_huge_pages(void* addr, size_t len);
+void* kmp_map_anonymous(size_t len, size_t* mapping_len, size_t* page_size);
+
+#endif
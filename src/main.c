@@ -57,7 +57,7 @@ void demo_multiple_search() {
             if (i < count - 1) printf(", ");
         }
         printf("\n");
-        free(positions);
+        kmp_free(positions);
     } else {
         printf("Pattern not found\n");
     }
@@ -95,8 +95,7 @@ void demo_with_statistics() {
             printf("Pattern not found\n");
         }
 
-        free(result->positions);
-        free(result);
+        kmp_free_result(result);
     }
 
     kmp_destroy(matcher);
@@ -146,9 +145,11 @@ void print_usage(const char* program_name) {
     printf("  -h, --help          Show this help message\n");
     printf("  -d, --demo          Run all demo functions\n");
     printf("  -s, --search PATTERN TEXT  Search for PATTERN in TEXT\n");
+    printf("  -m, --metrics       Run all demos and print search metrics\n");
     printf("\nExamples:\n");
     printf("  %s --demo\n", program_name);
     printf("  %s --search \"abc\" \"abcdefabcabc\"\n", program_name);
+    printf("  %s --metrics\n", program_name);
 }
 
 int main(int argc, char* argv[]) {
@@ -176,6 +177,22 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
+    if (argc == 2 && (strcmp(argv[1], "-m") == 0 || strcmp(argv[1], "--metrics") == 0)) {
+        kmp_metrics_enable(true);
+        demo_basic_search();
+        demo_multiple_search();
+        demo_with_statistics();
+        demo_edge_cases();
+
+        KMPMetricsSnapshot snapshot;
+        kmp_metrics_snapshot(&snapshot);
+        printf("\n=== Search Metrics ===\n");
+        printf("p50 latency: %llu ns\n", (unsigned long long)kmp_metrics_percentile(&snapshot, 50.0));
+        printf("p99 latency: %llu ns\n", (unsigned long long)kmp_metrics_percentile(&snapshot, 99.0));
+        kmp_metrics_write_prometheus(stdout);
+        return 0;
+    }
+
     if (argc == 4 && (strcmp(argv[1], "-s") == 0 || strcmp(argv[1], "--search") == 0)) {
         const char* pattern = argv[2];
         const char* text = argv[3];
@@ -206,7 +223,7 @@ int main(int argc, char* argv[]) {
                 if (i < count - 1) printf(", ");
             }
             printf("\n");
-            free(positions);
+            kmp_free(positions);
         } else {
             printf("Pattern not found\n");
         }
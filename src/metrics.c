@@ -0,0 +1,224 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/kmp.h"
+
+typedef struct {
+    unsigned long long searches;
+    unsigned long long bytes_scanned;
+    unsigned long long matches;
+    unsigned long long latency_sum_ns;
+    unsigned long long engine_calls[KMP_ENGINE_AUTO];
+    unsigned long long latency_buckets[KMP_METRICS_BUCKETS];
+} MetricCounters;
+
+/* Each thread that records a search gets its own counter block, linked into a
+ * global list on first use. Only the owning thread writes the counts, so
+ * updates are plain relaxed load/store pairs; snapshots sum all blocks.
+ * Blocks outlive their threads so no counts are lost.
+ *
+ * A reset cannot clear counts the owner may be bumping at the same moment,
+ * so it records them as the baseline instead and snapshots report the
+ * difference. The baseline is only touched under metrics_lock. */
+typedef struct ThreadMetrics {
+    MetricCounters counts;
+    MetricCounters baseline;
+    struct ThreadMetrics* next;
+} ThreadMetrics;
+
+static bool metrics_enabled = false;
+static ThreadMetrics* metrics_threads = NULL;
+static pthread_mutex_t metrics_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread ThreadMetrics* thread_metrics = NULL;
+
+#define BUMP(field, amount) \
+    __atomic_store_n(&(field), __atomic_load_n(&(field), __ATOMIC_RELAXED) + (amount), \
+                     __ATOMIC_RELAXED)
+
+uint64_t kmp_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void kmp_metrics_enable(bool enabled) {
+    __atomic_store_n(&metrics_enabled, enabled, __ATOMIC_RELAXED);
+}
+
+bool kmp_metrics_enabled(void) {
+    return __atomic_load_n(&metrics_enabled, __ATOMIC_RELAXED);
+}
+
+/* Log-linear buckets: 16 sub-buckets per power of two, exact below 16 ns. */
+int kmp_metrics_bucket(uint64_t ns) {
+    if (ns < 16) {
+        return (int)ns;
+    }
+
+    int exponent = 63 - __builtin_clzll(ns);
+    int index = (exponent - 3) * 16 + (int)((ns >> (exponent - 4)) & 15);
+    return index < KMP_METRICS_BUCKETS ? index : KMP_METRICS_BUCKETS - 1;
+}
+
+uint64_t kmp_metrics_bucket_floor(int bucket) {
+    if (bucket < 16) {
+        return (uint64_t)bucket;
+    }
+
+    int exponent = bucket / 16 + 3;
+    return (uint64_t)(16 + bucket % 16) << (exponent - 4);
+}
+
+static ThreadMetrics* current_thread_metrics(void) {
+    if (thread_metrics) {
+        return thread_metrics;
+    }
+
+    ThreadMetrics* block = (ThreadMetrics*)kmp_calloc(1, sizeof(ThreadMetrics));
+    if (!block) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&metrics_lock);
+    block->next = metrics_threads;
+    metrics_threads = block;
+    pthread_mutex_unlock(&metrics_lock);
+
+    thread_metrics = block;
+    return block;
+}
+
+void kmp_metrics_record(KMPEngine engine, size_t bytes, size_t matches, uint64_t ns) {
+    ThreadMetrics* block = current_thread_metrics();
+    if (!block) {
+        return;
+    }
+
+    BUMP(block->counts.searches, 1);
+    BUMP(block->counts.bytes_scanned, bytes);
+    BUMP(block->counts.matches, matches);
+    BUMP(block->counts.latency_sum_ns, ns);
+    if (engine >= 0 && engine < KMP_ENGINE_AUTO) {
+        BUMP(block->counts.engine_calls[engine], 1);
+    }
+    BUMP(block->counts.latency_buckets[kmp_metrics_bucket(ns)], 1);
+}
+
+static void load_counters(const MetricCounters* counts, MetricCounters* out) {
+    out->searches = __atomic_load_n(&counts->searches, __ATOMIC_RELAXED);
+    out->bytes_scanned = __atomic_load_n(&counts->bytes_scanned, __ATOMIC_RELAXED);
+    out->matches = __atomic_load_n(&counts->matches, __ATOMIC_RELAXED);
+    out->latency_sum_ns = __atomic_load_n(&counts->latency_sum_ns, __ATOMIC_RELAXED);
+    for (int e = 0; e < KMP_ENGINE_AUTO; e++) {
+        out->engine_calls[e] = __atomic_load_n(&counts->engine_calls[e], __ATOMIC_RELAXED);
+    }
+    for (int b = 0; b < KMP_METRICS_BUCKETS; b++) {
+        out->latency_buckets[b] = __atomic_load_n(&counts->latency_buckets[b], __ATOMIC_RELAXED);
+    }
+}
+
+void kmp_metrics_snapshot(KMPMetricsSnapshot* snapshot) {
+    if (!snapshot) {
+        return;
+    }
+
+    memset(snapshot, 0, sizeof(KMPMetricsSnapshot));
+
+    pthread_mutex_lock(&metrics_lock);
+    for (ThreadMetrics* block = metrics_threads; block; block = block->next) {
+        MetricCounters counts;
+        const MetricCounters* base = &block->baseline;
+        load_counters(&block->counts, &counts);
+        snapshot->searches += counts.searches - base->searches;
+        snapshot->bytes_scanned += counts.bytes_scanned - base->bytes_scanned;
+        snapshot->matches += counts.matches - base->matches;
+        snapshot->latency_sum_ns += counts.latency_sum_ns - base->latency_sum_ns;
+        for (int e = 0; e < KMP_ENGINE_AUTO; e++) {
+            snapshot->engine_calls[e] += counts.engine_calls[e] - base->engine_calls[e];
+        }
+        for (int b = 0; b < KMP_METRICS_BUCKETS; b++) {
+            snapshot->latency_buckets[b] += counts.latency_buckets[b] - base->latency_buckets[b];
+        }
+    }
+    pthread_mutex_unlock(&metrics_lock);
+}
+
+void kmp_metrics_reset(void) {
+    pthread_mutex_lock(&metrics_lock);
+    for (ThreadMetrics* block = metrics_threads; block; block = block->next) {
+        load_counters(&block->counts, &block->baseline);
+    }
+    pthread_mutex_unlock(&metrics_lock);
+}
+
+uint64_t kmp_metrics_percentile(const KMPMetricsSnapshot* snapshot, double percentile) {
+    if (!snapshot || snapshot->searches == 0) {
+        return 0;
+    }
+
+    unsigned long long total = 0;
+    for (int b = 0; b < KMP_METRICS_BUCKETS; b++) {
+        total += snapshot->latency_buckets[b];
+    }
+
+    unsigned long long rank = (unsigned long long)(percentile / 100.0 * total);
+    if (rank >= total) {
+        rank = total - 1;
+    }
+
+    unsigned long long seen = 0;
+    for (int b = 0; b < KMP_METRICS_BUCKETS; b++) {
+        seen += snapshot->latency_buckets[b];
+        if (seen > rank) {
+            return kmp_metrics_bucket_floor(b);
+        }
+    }
+
+    return kmp_metrics_bucket_floor(KMP_METRICS_BUCKETS - 1);
+}
+
+void kmp_metrics_write_prometheus(FILE* out) {
+    if (!out) {
+        return;
+    }
+
+    KMPMetricsSnapshot snapshot;
+    kmp_metrics_snapshot(&snapshot);
+
+    fprintf(out, "# HELP kmp_searches_total Search calls recorded.\n");
+    fprintf(out, "# TYPE kmp_searches_total counter\n");
+    fprintf(out, "kmp_searches_total %llu\n", snapshot.searches);
+    fprintf(out, "# HELP kmp_bytes_scanned_total Text bytes scanned by searches.\n");
+    fprintf(out, "# TYPE kmp_bytes_scanned_total counter\n");
+    fprintf(out, "kmp_bytes_scanned_total %llu\n", snapshot.bytes_scanned);
+    fprintf(out, "# HELP kmp_matches_total Matches reported by searches.\n");
+    fprintf(out, "# TYPE kmp_matches_total counter\n");
+    fprintf(out, "kmp_matches_total %llu\n", snapshot.matches);
+
+    fprintf(out, "# HELP kmp_engine_calls_total Search calls per engine.\n");
+    fprintf(out, "# TYPE kmp_engine_calls_total counter\n");
+    for (int e = 0; e < KMP_ENGINE_AUTO; e++) {
+        fprintf(out, "kmp_engine_calls_total{engine=\"%s\"} %llu\n",
+                kmp_engine_name((KMPEngine)e), snapshot.engine_calls[e]);
+    }
+
+    /* Exported at fixed power-of-two boundaries from 128 ns to ~137 s; the
+     * in-process histogram keeps 16 sub-buckets per boundary. */
+    fprintf(out, "# HELP kmp_search_latency_seconds Search call latency.\n");
+    fprintf(out, "# TYPE kmp_search_latency_seconds histogram\n");
+    unsigned long long cumulative = 0;
+    unsigned long long total = 0;
+    int bucket = 0;
+    for (int b = 0; b < KMP_METRICS_BUCKETS; b++) {
+        total += snapshot.latency_buckets[b];
+    }
+    for (int exponent = 7; exponent <= 37; exponent++) {
+        int limit = kmp_metrics_bucket(1ULL << exponent);
+        while (bucket < limit) {
+            cumulative += snapshot.latency_buckets[bucket++];
+        }
+        fprintf(out, "kmp_search_latency_seconds_bucket{le=\"%.9g\"} %llu\n",
+                (double)(1ULL << exponent) / 1e9, cumulative);
+    }
+    fprintf(out, "kmp_search_latency_seconds_bucket{le=\"+Inf\"} %llu\n", total);
+    fprintf(out, "kmp_search_latency_seconds_sum %.9f\n", snapshot.latency_sum_ns / 1e9);
+    fprintf(out, "kmp_search_latency_seconds_count %llu\n", total);
+}
@@ -0,0 +1,290 @@
+#include "kmp_internal.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KMP_HAVE_X86 1
+#endif
+
+#define KMP_MULTI_LANE_GROUP 4
+#define KMP_MULTI_BLOCK 4096
+
+/* Patterns are packed into 64-bit lanes, each pattern's first
+ * KMP_MULTI_PREFIX bytes taking one contiguous segment. Every lane runs
+ * Shift-And independently: a left shift never carries out of the lane, and
+ * the start mask re-seeds the first bit of every segment on each byte, so
+ * segments cannot leak into their neighbours. A set end bit is a match of
+ * the prefix; longer patterns are then verified with memcmp. */
+
+typedef struct {
+    KMPMultiMatch* matches;
+    size_t count;
+    size_t capacity;
+    bool failed;
+} MultiMatchList;
+
+static void add_match(MultiMatchList* list, size_t position, int pattern) {
+    if (list->failed) {
+        return;
+    }
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 16;
+        KMPMultiMatch* grown = (KMPMultiMatch*)kmp_realloc(list->matches,
+                                                       capacity * sizeof(KMPMultiMatch));
+        if (!grown) {
+            list->failed = true;
+            return;
+        }
+        list->matches = grown;
+        list->capacity = capacity;
+    }
+    list->matches[list->count].position = position;
+    list->matches[list->count].pattern = pattern;
+    list->count++;
+}
+
+/* Byte i completed the prefixes flagged in hits; confirm each pattern. */
+static void report_hits(const KMPMultiMatcher* matcher, const char* text, size_t len,
+                        size_t i, int lane, uint64_t hits, MultiMatchList* list) {
+    while (hits) {
+        int bit = __builtin_ctzll(hits);
+        hits &= hits - 1;
+
+        int pattern = matcher->bit_owner[lane * 64 + bit];
+        int prefix = matcher->pattern_lens[pattern] < KMP_MULTI_PREFIX ?
+                     matcher->pattern_lens[pattern] : KMP_MULTI_PREFIX;
+        size_t start = i + 1 - prefix;
+        size_t m = matcher->pattern_lens[pattern];
+        if (m > (size_t)prefix &&
+            (start + m > len || memcmp(text + start + prefix,
+                                       matcher->patterns[pattern] + prefix, m - prefix) != 0)) {
+            continue;
+        }
+        add_match(list, start, pattern);
+    }
+}
+
+static void scan_scalar(const KMPMultiMatcher* matcher, const char* text, size_t len,
+                        uint64_t* state, MultiMatchList* list) {
+    const unsigned char* bytes = (const unsigned char*)text;
+    int lanes = matcher->lane_count;
+
+    for (size_t block = 0; block < len; block += KMP_MULTI_BLOCK) {
+        size_t block_end = len - block < KMP_MULTI_BLOCK ? len : block + KMP_MULTI_BLOCK;
+        for (int lane = 0; lane < lanes; lane++) {
+            uint64_t d = state[lane];
+            uint64_t start = matcher->start_bits[lane];
+            uint64_t end = matcher->end_bits[lane];
+            for (size_t i = block; i < block_end; i++) {
+                d = ((d << 1) | start) & matcher->masks[(size_t)bytes[i] * lanes + lane];
+                if (d & end) {
+                    report_hits(matcher, text, len, i, lane, d & end, list);
+                }
+            }
+            state[lane] = d;
+        }
+    }
+}
+
+#ifdef KMP_HAVE_X86
+/* Four lanes per 256-bit register. Each group of lanes runs over a block
+ * that stays in L1 before the next group starts, so the text is streamed
+ * from memory once however many groups there are. */
+__attribute__((target("avx2")))
+static void scan_avx2(const KMPMultiMatcher* matcher, const char* text, size_t len,
+                      uint64_t* state, MultiMatchList* list) {
+    const unsigned char* bytes = (const unsigned char*)text;
+    int lanes = matcher->lane_count;
+
+    for (size_t block = 0; block < len; block += KMP_MULTI_BLOCK) {
+        size_t block_end = len - block < KMP_MULTI_BLOCK ? len : block + KMP_MULTI_BLOCK;
+        for (int group = 0; group < lanes; group += KMP_MULTI_LANE_GROUP) {
+            __m256i d = _mm256_loadu_si256((const __m256i*)(state + group));
+            __m256i start = _mm256_loadu_si256((const __m256i*)(matcher->start_bits + group));
+            __m256i end = _mm256_loadu_si256((const __m256i*)(matcher->end_bits + group));
+            const uint64_t* masks = matcher->masks + group;
+
+            for (size_t i = block; i < block_end; i++) {
+                __m256i mask = _mm256_loadu_si256((const __m256i*)(masks + (size_t)bytes[i] * lanes));
+                d = _mm256_and_si256(_mm256_or_si256(_mm256_slli_epi64(d, 1), start), mask);
+                if (!_mm256_testz_si256(d, end)) {
+                    uint64_t hits[KMP_MULTI_LANE_GROUP];
+                    _mm256_storeu_si256((__m256i*)hits, _mm256_and_si256(d, end));
+                    for (int k = 0; k < KMP_MULTI_LANE_GROUP; k++) {
+                        if (hits[k]) {
+                            report_hits(matcher, text, len, i, group + k, hits[k], list);
+                        }
+                    }
+                }
+            }
+            _mm256_storeu_si256((__m256i*)(state + group), d);
+        }
+    }
+}
+#endif
+
+bool kmp_multi_simd_available(void) {
+#ifdef KMP_HAVE_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+KMPMultiMatcher* kmp_multi_create(const char* const* patterns, int count) {
+    if (!patterns || count <= 0) {
+        return NULL;
+    }
+
+    KMPMultiMatcher* matcher = (KMPMultiMatcher*)kmp_calloc(1, sizeof(KMPMultiMatcher));
+    if (!matcher) {
+        return NULL;
+    }
+    matcher->pattern_count = count;
+    matcher->patterns = (char**)kmp_calloc(count, sizeof(char*));
+    matcher->pattern_lens = (int*)kmp_malloc(count * sizeof(int));
+    int* lane_of = (int*)kmp_malloc(count * sizeof(int));
+    int* offset_of = (int*)kmp_malloc(count * sizeof(int));
+    if (!matcher->patterns || !matcher->pattern_lens || !lane_of || !offset_of) {
+        kmp_free(lane_of);
+        kmp_free(offset_of);
+        kmp_multi_destroy(matcher);
+        return NULL;
+    }
+
+    int lanes = 0;
+    int used = 64;
+    for (int p = 0; p < count; p++) {
+        if (!patterns[p] || patterns[p][0] == '\0') {
+            kmp_free(lane_of);
+            kmp_free(offset_of);
+            kmp_multi_destroy(matcher);
+            return NULL;
+        }
+        matcher->patterns[p] = kmp_strdup(patterns[p]);
+        if (!matcher->patterns[p]) {
+            kmp_free(lane_of);
+            kmp_free(offset_of);
+            kmp_multi_destroy(matcher);
+            return NULL;
+        }
+        matcher->pattern_lens[p] = strlen(patterns[p]);
+
+        int prefix = matcher->pattern_lens[p] < KMP_MULTI_PREFIX ?
+                     matcher->pattern_lens[p] : KMP_MULTI_PREFIX;
+        if (used + prefix > 64) {
+            lanes++;
+            used = 0;
+        }
+        lane_of[p] = lanes - 1;
+        offset_of[p] = used;
+        used += prefix;
+    }
+
+    matcher->lane_count = (lanes + KMP_MULTI_LANE_GROUP - 1) / KMP_MULTI_LANE_GROUP *
+                          KMP_MULTI_LANE_GROUP;
+    int total_lanes = matcher->lane_count;
+    matcher->masks = (uint64_t*)kmp_calloc((size_t)256 * total_lanes, sizeof(uint64_t));
+    matcher->start_bits = (uint64_t*)kmp_calloc(total_lanes, sizeof(uint64_t));
+    matcher->end_bits = (uint64_t*)kmp_calloc(total_lanes, sizeof(uint64_t));
+    matcher->bit_owner = (int*)kmp_malloc((size_t)total_lanes * 64 * sizeof(int));
+    if (!matcher->masks || !matcher->start_bits || !matcher->end_bits || !matcher->bit_owner) {
+        kmp_free(lane_of);
+        kmp_free(offset_of);
+        kmp_multi_destroy(matcher);
+        return NULL;
+    }
+
+    for (int b = 0; b < total_lanes * 64; b++) {
+        matcher->bit_owner[b] = -1;
+    }
+    for (int p = 0; p < count; p++) {
+        int lane = lane_of[p];
+        int offset = offset_of[p];
+        int prefix = matcher->pattern_lens[p] < KMP_MULTI_PREFIX ?
+                     matcher->pattern_lens[p] : KMP_MULTI_PREFIX;
+        matcher->start_bits[lane] |= 1ULL << offset;
+        matcher->end_bits[lane] |= 1ULL << (offset + prefix - 1);
+        matcher->bit_owner[lane * 64 + offset + prefix - 1] = p;
+        for (int k = 0; k < prefix; k++) {
+            unsigned char c = (unsigned char)matcher->patterns[p][k];
+            matcher->masks[(size_t)c * total_lanes + lane] |= 1ULL << (offset + k);
+        }
+    }
+    kmp_free(lane_of);
+    kmp_free(offset_of);
+
+    matcher->use_simd = kmp_multi_simd_available();
+    matcher->memory_usage = sizeof(KMPMultiMatcher) +
+                            (size_t)256 * total_lanes * sizeof(uint64_t) +
+                            (size_t)total_lanes * (2 * sizeof(uint64_t) + 64 * sizeof(int));
+    for (int p = 0; p < count; p++) {
+        matcher->memory_usage += matcher->pattern_lens[p] + 1 + sizeof(char*) + sizeof(int);
+    }
+    return matcher;
+}
+
+void kmp_multi_destroy(KMPMultiMatcher* matcher) {
+    if (!matcher) {
+        return;
+    }
+    for (int p = 0; matcher->patterns && p < matcher->pattern_count; p++) {
+        kmp_free(matcher->patterns[p]);
+    }
+    kmp_free(matcher->patterns);
+    kmp_free(matcher->pattern_lens);
+    kmp_free(matcher->masks);
+    kmp_free(matcher->start_bits);
+    kmp_free(matcher->end_bits);
+    kmp_free(matcher->bit_owner);
+    kmp_free(matcher);
+}
+
+static int compare_multi_match(const void* a, const void* b) {
+    const KMPMultiMatch* x = (const KMPMultiMatch*)a;
+    const KMPMultiMatch* y = (const KMPMultiMatch*)b;
+    if (x->position != y->position) {
+        return x->position < y->position ? -1 : 1;
+    }
+    return (x->pattern > y->pattern) - (x->pattern < y->pattern);
+}
+
+/* Returns every (position, pattern) pair ordered by position, then by
+ * pattern index. */
+KMPMultiMatch* kmp_multi_search_all(const KMPMultiMatcher* matcher, const char* text,
+                                    size_t len, size_t* count) {
+    if (!count) {
+        return NULL;
+    }
+    *count = 0;
+
+    if (!matcher || !text) {
+        return NULL;
+    }
+
+    uint64_t* state = (uint64_t*)kmp_calloc(matcher->lane_count, sizeof(uint64_t));
+    if (!state) {
+        return NULL;
+    }
+
+    MultiMatchList list = {NULL, 0, 0, false};
+#ifdef KMP_HAVE_X86
+    if (matcher->use_simd) {
+        scan_avx2(matcher, text, len, state, &list);
+    } else {
+        scan_scalar(matcher, text, len, state, &list);
+    }
+#else
+    scan_scalar(matcher, text, len, state, &list);
+#endif
+    kmp_free(state);
+
+    if (list.failed || list.count == 0) {
+        kmp_free(list.matches);
+        return NULL;
+    }
+
+    qsort(list.matches, list.count, sizeof(KMPMultiMatch), compare_multi_match);
+    *count = list.count;
+    return list.matches;
+}
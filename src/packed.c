@@ -0,0 +1,186 @@
+#include "../include/kmp.h"
+#include <limits.h>
+
+/* Bases are stored 2 bits each, base i in bits 2*(i % 32) of word i / 32.
+ * One zero word of padding lets windows be read without bounds checks. */
+
+static int encode_base(char c) {
+    switch (c) {
+        case 'A': case 'a': return 0;
+        case 'C': case 'c': return 1;
+        case 'G': case 'g': return 2;
+        case 'T': case 't': return 3;
+        default: return -1;
+    }
+}
+
+KMPPackedSeq* kmp_packed_from_string(const char* bases, size_t len) {
+    if (!bases || len == 0) {
+        return NULL;
+    }
+
+    KMPPackedSeq* seq = (KMPPackedSeq*)kmp_malloc(sizeof(KMPPackedSeq));
+    if (!seq) {
+        return NULL;
+    }
+
+    seq->length = len;
+    seq->word_count = (len + 31) / 32 + 1;
+    seq->words = (uint64_t*)kmp_calloc(seq->word_count, sizeof(uint64_t));
+    if (!seq->words) {
+        kmp_free(seq);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        int code = encode_base(bases[i]);
+        if (code < 0) {
+            kmp_packed_destroy(seq);
+            return NULL;
+        }
+        seq->words[i / 32] |= (uint64_t)code << (2 * (i % 32));
+    }
+
+    return seq;
+}
+
+void kmp_packed_destroy(KMPPackedSeq* seq) {
+    if (seq) {
+        kmp_free(seq->words);
+        kmp_free(seq);
+    }
+}
+
+char kmp_packed_base_at(const KMPPackedSeq* seq, size_t index) {
+    static const char bases[] = "ACGT";
+    if (!seq || index >= seq->length) {
+        return '\0';
+    }
+    return bases[(seq->words[index / 32] >> (2 * (index % 32))) & 3];
+}
+
+static inline int code_at(const uint64_t* words, size_t position) {
+    return (int)((words[position / 32] >> (2 * (position % 32))) & 3);
+}
+
+/* First position in [from, last] whose window starts with head under mask,
+ * or SIZE_MAX. 32 shift/compare steps per 64-bit text word, with no
+ * per-base loads. */
+static size_t next_head(const uint64_t* words, size_t from, size_t last,
+                        uint64_t head, uint64_t mask) {
+    for (size_t word = from / 32; word * 32 <= last; word++) {
+        uint64_t lo = words[word];
+        uint64_t hi = words[word + 1];
+        size_t base = word * 32;
+        unsigned first = word == from / 32 ? (unsigned)(from % 32) : 0;
+        unsigned limit = last - base < 31 ? (unsigned)(last - base) : 31;
+
+        for (unsigned s = first; s <= limit; s++) {
+            uint64_t window = s ? (lo >> (2 * s)) | (hi << (64 - 2 * s)) : lo;
+            if ((window & mask) == head) {
+                return base + s;
+            }
+        }
+    }
+    return SIZE_MAX;
+}
+
+static bool append_position(size_t** positions, size_t* found, size_t* capacity,
+                            size_t position) {
+    if (*found == *capacity) {
+        size_t* grown = (size_t*)kmp_realloc(*positions, *capacity * 2 * sizeof(size_t));
+        if (!grown) {
+            return false;
+        }
+        *positions = grown;
+        *capacity *= 2;
+    }
+    (*positions)[(*found)++] = position;
+    return true;
+}
+
+/* Patterns of up to 32 bases are matched whole by the word filter. Longer
+ * ones use it only to find the next window starting with their first 32
+ * bases; from there KMP over the 2-bit codes takes over, resuming the filter
+ * once it falls back to state 0. Every base is read at most once by each, so
+ * the scan stays linear however periodic the pattern and text are. */
+size_t* kmp_packed_search_all(const KMPPackedSeq* text, const KMPPackedSeq* pattern,
+                              size_t* count) {
+    if (!count) {
+        return NULL;
+    }
+    *count = 0;
+
+    if (!text || !pattern || pattern->length > text->length || pattern->length > INT_MAX) {
+        return NULL;
+    }
+
+    size_t n = text->length;
+    size_t m = pattern->length;
+    size_t last = n - m;
+    uint64_t mask = m >= 32 ? ~0ULL : (1ULL << (2 * m)) - 1;
+    uint64_t head = pattern->words[0] & mask;
+
+    char* codes = NULL;
+    int* lps = NULL;
+    if (m > 32) {
+        codes = (char*)kmp_malloc(m);
+        lps = (int*)kmp_malloc(m * sizeof(int));
+        if (!codes || !lps) {
+            kmp_free(codes);
+            kmp_free(lps);
+            return NULL;
+        }
+        for (size_t j = 0; j < m; j++) {
+            codes[j] = (char)code_at(pattern->words, j);
+        }
+        kmp_build_failure_tables(codes, (int)m, lps, NULL);
+    }
+
+    size_t capacity = 16;
+    size_t found = 0;
+    size_t* positions = (size_t*)kmp_malloc(capacity * sizeof(size_t));
+    bool ok = positions != NULL;
+
+    size_t i = 0;
+    while (ok && i <= last) {
+        size_t hit = next_head(text->words, i, last, head, mask);
+        if (hit == SIZE_MAX) {
+            break;
+        }
+        if (m <= 32) {
+            ok = append_position(&positions, &found, &capacity, hit);
+            i = hit + 1;
+            continue;
+        }
+
+        size_t j = 32;
+        for (i = hit + 32; i < n && j > 0; i++) {
+            int c = code_at(text->words, i);
+            while (j > 0 && codes[j] != c) {
+                j = lps[j - 1];
+            }
+            if (codes[j] == c) {
+                j++;
+            }
+            if (j == m) {
+                ok = append_position(&positions, &found, &capacity, i + 1 - m);
+                j = lps[m - 1];
+            }
+        }
+        if (!ok || i >= n) {
+            break;
+        }
+    }
+
+    kmp_free(codes);
+    kmp_free(lps);
+    if (!ok || found == 0) {
+        kmp_free(positions);
+        return NULL;
+    }
+
+    *count = found;
+    size_t* result = (size_t*)kmp_realloc(positions, found * sizeof(size_t));
+    return result ? result : positions;
+}
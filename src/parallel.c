@@ -0,0 +1,437 @@
+#define _GNU_SOURCE
+#include "kmp_internal.h"
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define KMP_SYSFS_NODES "/sys/devices/system/node"
+
+/* Parses a sysfs list such as "0-3,8,10-11" into values; returns the count,
+ * or -1 when more than capacity values are listed. */
+static int parse_list(const char* list, int* values, int capacity) {
+    int count = 0;
+    const char* p = list;
+
+    while (*p && *p != '\n') {
+        char* end;
+        long first = strtol(p, &end, 10);
+        if (end == p) {
+            return -1;
+        }
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p) {
+                return -1;
+            }
+        }
+        for (long v = first; v <= last; v++) {
+            if (count == capacity) {
+                return -1;
+            }
+            values[count++] = (int)v;
+        }
+        p = (*end == ',') ? end + 1 : end;
+    }
+
+    return count;
+}
+
+static bool read_line(const char* path, char* buffer, size_t size) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    bool ok = fgets(buffer, (int)size, file) != NULL;
+    fclose(file);
+    return ok;
+}
+
+static bool single_node(KMPTopology* topology) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    int cpus = online > 0 ? (int)online : 1;
+
+    topology->node_count = 1;
+    topology->node_ids[0] = 0;
+    topology->node_cpus[0] = (int*)kmp_malloc(cpus * sizeof(int));
+    if (!topology->node_cpus[0]) {
+        return false;
+    }
+    for (int i = 0; i < cpus; i++) {
+        topology->node_cpus[0][i] = i;
+    }
+    topology->node_cpu_count[0] = cpus;
+    return true;
+}
+
+/* Reads the nodes that have CPUs from sysfs. Machines without the node
+ * directory (or with an unreadable one) are reported as one node holding
+ * every online CPU, so callers never need a separate non-NUMA path. */
+KMPError kmp_topology_detect(KMPTopology* topology) {
+    if (!topology) {
+        return KMP_ERROR_NULL_POINTER;
+    }
+    memset(topology, 0, sizeof(KMPTopology));
+
+    char line[4096];
+    int nodes[KMP_MAX_NUMA_NODES];
+    int node_count = -1;
+    if (read_line(KMP_SYSFS_NODES "/has_cpu", line, sizeof(line)) ||
+        read_line(KMP_SYSFS_NODES "/online", line, sizeof(line))) {
+        node_count = parse_list(line, nodes, KMP_MAX_NUMA_NODES);
+    }
+
+    long online = sysconf(_SC_NPROCESSORS_CONF);
+    int max_cpus = online > 0 ? (int)online : 1;
+    int* cpus = (int*)kmp_malloc(max_cpus * sizeof(int));
+    if (!cpus) {
+        return KMP_ERROR_MEMORY_ALLOCATION;
+    }
+
+    for (int n = 0; n < node_count; n++) {
+        char path[128];
+        snprintf(path, sizeof(path), KMP_SYSFS_NODES "/node%d/cpulist", nodes[n]);
+        if (!read_line(path, line, sizeof(line))) {
+            continue;
+        }
+        int count = parse_list(line, cpus, max_cpus);
+        if (count <= 0) {
+            continue;
+        }
+
+        int k = topology->node_count;
+        topology->node_cpus[k] = (int*)kmp_malloc(count * sizeof(int));
+        if (!topology->node_cpus[k]) {
+            kmp_free(cpus);
+            kmp_topology_free(topology);
+            return KMP_ERROR_MEMORY_ALLOCATION;
+        }
+        memcpy(topology->node_cpus[k], cpus, count * sizeof(int));
+        topology->node_cpu_count[k] = count;
+        topology->node_ids[k] = nodes[n];
+        topology->node_count++;
+    }
+    kmp_free(cpus);
+
+    if (topology->node_count == 0 && !single_node(topology)) {
+        return KMP_ERROR_MEMORY_ALLOCATION;
+    }
+    return KMP_SUCCESS;
+}
+
+void kmp_topology_free(KMPTopology* topology) {
+    if (!topology) {
+        return;
+    }
+    for (int n = 0; n < topology->node_count; n++) {
+        kmp_free(topology->node_cpus[n]);
+        topology->node_cpus[n] = NULL;
+    }
+    topology->node_count = 0;
+}
+
+static int topology_cpu_total(const KMPTopology* topology) {
+    int total = 0;
+    for (int n = 0; n < topology->node_count; n++) {
+        total += topology->node_cpu_count[n];
+    }
+    return total;
+}
+
+/* Pins the calling thread to every CPU of one node. Failure (for example
+ * inside a restricted cpuset) only costs locality, so it is ignored. */
+static void pin_to_node(const KMPTopology* topology, int node) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int i = 0; i < topology->node_cpu_count[node]; i++) {
+        int cpu = topology->node_cpus[node][i];
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+typedef struct {
+    KMPNumaText* text;
+    const char* source;
+    int node;
+} PlacementTask;
+
+static void* place_node_slice(void* arg) {
+    PlacementTask* task = (PlacementTask*)arg;
+    KMPNumaText* text = task->text;
+    size_t first = text->node_offsets[task->node];
+    size_t last = text->node_offsets[task->node + 1];
+
+    pin_to_node(&text->topology, task->node);
+    memcpy(text->data + first, task->source + first, last - first);
+    return NULL;
+}
+
+/* Copies len bytes into an anonymous mapping split into one page-aligned
+ * slice per node, sized by the node's CPU count. Each slice is written by a
+ * thread pinned to its node, so first-touch allocates its pages there. */
+KMPNumaText* kmp_numa_text_create(const char* source, size_t len) {
+    if (!source || len == 0) {
+        return NULL;
+    }
+
+    KMPNumaText* text = (KMPNumaText*)kmp_calloc(1, sizeof(KMPNumaText));
+    if (!text) {
+        return NULL;
+    }
+    if (kmp_topology_detect(&text->topology) != KMP_SUCCESS) {
+        kmp_free(text);
+        return NULL;
+    }
+
+    text->data = (char*)kmp_map_anonymous(len, &text->mapping_len, &text->page_size);
+    if (!text->data) {
+        kmp_topology_free(&text->topology);
+        kmp_free(text);
+        return NULL;
+    }
+    text->len = len;
+
+    const KMPTopology* topology = &text->topology;
+    int nodes = topology->node_count;
+    int total_cpus = topology_cpu_total(topology);
+    size_t page = text->page_size;
+    size_t assigned_cpus = 0;
+    text->node_offsets[0] = 0;
+    for (int n = 0; n < nodes; n++) {
+        assigned_cpus += topology->node_cpu_count[n];
+        size_t boundary = len * assigned_cpus / total_cpus / page * page;
+        if (n == nodes - 1 || boundary > len) {
+            boundary = len;
+        }
+        if (boundary < text->node_offsets[n]) {
+            boundary = text->node_offsets[n];
+        }
+        text->node_offsets[n + 1] = boundary;
+    }
+
+    PlacementTask tasks[KMP_MAX_NUMA_NODES];
+    pthread_t threads[KMP_MAX_NUMA_NODES];
+    bool started[KMP_MAX_NUMA_NODES] = {false};
+    for (int n = 0; n < nodes; n++) {
+        tasks[n].text = text;
+        tasks[n].source = source;
+        tasks[n].node = n;
+        started[n] = pthread_create(&threads[n], NULL, place_node_slice, &tasks[n]) == 0;
+        if (!started[n]) {
+            place_node_slice(&tasks[n]);
+        }
+    }
+    for (int n = 0; n < nodes; n++) {
+        if (started[n]) {
+            pthread_join(threads[n], NULL);
+        }
+    }
+
+    return text;
+}
+
+void kmp_numa_text_destroy(KMPNumaText* text) {
+    if (!text) {
+        return;
+    }
+    munmap(text->data, text->mapping_len);
+    kmp_topology_free(&text->topology);
+    kmp_free(text);
+}
+
+typedef struct {
+    const KMPNumaText* text;
+    KMPMatcher* replica;
+    int node;
+    size_t start;
+    size_t end;
+    size_t* positions;
+    size_t count;
+    uint64_t elapsed_ns;
+    KMPError error;
+} ScanWorker;
+
+/* Matches starting in [start, end) are reported, so the scan reads up to
+ * pattern_len - 1 bytes past end; they may sit on the neighbouring node. */
+static void* scan_worker_main(void* arg) {
+    ScanWorker* worker = (ScanWorker*)arg;
+    const KMPNumaText* text = worker->text;
+    if (worker->start == worker->end) {
+        return NULL;
+    }
+    pin_to_node(&text->topology, worker->node);
+
+    uint64_t begin = kmp_now_ns();
+    size_t limit = worker->end + worker->replica->pattern_len - 1;
+    KMPSearchOptions options = {worker->start, limit < text->len ? limit : text->len, NULL, 0};
+    KMPSearchState cursor;
+    kmp_search_state_init(&cursor);
+    worker->error = kmp_search_range(worker->replica, text->data, text->len, &options,
+                                     &cursor, &worker->positions, &worker->count);
+    worker->elapsed_ns = kmp_now_ns() - begin;
+    return NULL;
+}
+
+typedef struct {
+    const KMPNumaText* text;
+    const KMPMatcher* source;
+    int node;
+    KMPMatcher* replica;
+} ReplicaTask;
+
+/* Compiles the node's copy of the tables on that node. */
+static void* build_replica(void* arg) {
+    ReplicaTask* task = (ReplicaTask*)arg;
+    pin_to_node(&task->text->topology, task->node);
+    KMPOptions options = {0, task->source->engine, NULL, 0};
+    task->replica = kmp_create_ex(task->source->pattern, &options);
+    return NULL;
+}
+
+size_t* kmp_parallel_search_all(KMPMatcher* matcher, const KMPNumaText* text,
+                                int threads, size_t* count, KMPParallelStats* stats) {
+    if (!count) {
+        return NULL;
+    }
+    *count = 0;
+
+    if (!text || kmp_compile(matcher) != KMP_SUCCESS) {
+        return NULL;
+    }
+
+    const KMPTopology* topology = &text->topology;
+    int nodes = topology->node_count;
+    if (threads <= 0) {
+        threads = topology_cpu_total(topology);
+    }
+    if (threads < nodes) {
+        threads = nodes;
+    }
+
+    ReplicaTask replicas[KMP_MAX_NUMA_NODES];
+    pthread_t replica_threads[KMP_MAX_NUMA_NODES];
+    bool replica_started[KMP_MAX_NUMA_NODES] = {false};
+    for (int n = 0; n < nodes; n++) {
+        replicas[n].text = text;
+        replicas[n].source = matcher;
+        replicas[n].node = n;
+        replicas[n].replica = NULL;
+        replica_started[n] = pthread_create(&replica_threads[n], NULL, build_replica,
+                                            &replicas[n]) == 0;
+        if (!replica_started[n]) {
+            build_replica(&replicas[n]);
+        }
+    }
+    for (int n = 0; n < nodes; n++) {
+        if (replica_started[n]) {
+            pthread_join(replica_threads[n], NULL);
+        }
+    }
+
+    ScanWorker* workers = (ScanWorker*)kmp_calloc(threads, sizeof(ScanWorker));
+    pthread_t* handles = (pthread_t*)kmp_calloc(threads, sizeof(pthread_t));
+    bool* started = (bool*)kmp_calloc(threads, sizeof(bool));
+    bool ok = workers && handles && started;
+    for (int n = 0; n < nodes; n++) {
+        ok = ok && replicas[n].replica;
+    }
+
+    if (ok) {
+        /* Threads go round-robin over nodes; each node's slice is split
+         * evenly among the threads it received. */
+        for (int n = 0; n < nodes; n++) {
+            int node_threads = threads / nodes + (n < threads % nodes);
+            size_t first = text->node_offsets[n];
+            size_t span = text->node_offsets[n + 1] - first;
+            for (int t = 0; t < node_threads; t++) {
+                ScanWorker* worker = &workers[n + t * nodes];
+                worker->text = text;
+                worker->replica = replicas[n].replica;
+                worker->node = n;
+                worker->start = first + span * t / node_threads;
+                worker->end = first + span * (t + 1) / node_threads;
+            }
+        }
+
+        for (int i = 0; i < threads; i++) {
+            started[i] = pthread_create(&handles[i], NULL, scan_worker_main, &workers[i]) == 0;
+            if (!started[i]) {
+                scan_worker_main(&workers[i]);
+            }
+        }
+        for (int i = 0; i < threads; i++) {
+            if (started[i]) {
+                pthread_join(handles[i], NULL);
+            }
+        }
+    }
+
+    size_t total = 0;
+    for (int i = 0; ok && i < threads; i++) {
+        ok = workers[i].error == KMP_SUCCESS;
+        total += workers[i].count;
+    }
+
+    if (ok && stats) {
+        memset(stats, 0, sizeof(KMPParallelStats));
+        stats->node_count = nodes;
+        for (int n = 0; n < nodes; n++) {
+            stats->node_ids[n] = topology->node_ids[n];
+        }
+        for (int i = 0; i < threads; i++) {
+            int n = workers[i].node;
+            stats->node_threads[n]++;
+            stats->node_bytes[n] += workers[i].end - workers[i].start;
+            if (workers[i].elapsed_ns > stats->node_ns[n]) {
+                stats->node_ns[n] = workers[i].elapsed_ns;
+            }
+        }
+    }
+
+    size_t* positions = NULL;
+    if (ok && total > 0) {
+        positions = (size_t*)kmp_malloc(total * sizeof(size_t));
+        ok = positions != NULL;
+    }
+
+    /* Worker ranges tile the text in offset order once sorted by start. */
+    if (positions) {
+        size_t written = 0;
+        size_t cursor = 0;
+        for (int done = 0; done < threads; done++) {
+            int next = -1;
+            for (int i = 0; i < threads; i++) {
+                if (workers[i].start == cursor && workers[i].end > cursor) {
+                    next = i;
+                    break;
+                }
+            }
+            if (next < 0) {
+                break;
+            }
+            if (workers[next].count) {
+                memcpy(positions + written, workers[next].positions,
+                       workers[next].count * sizeof(size_t));
+            }
+            written += workers[next].count;
+            cursor = workers[next].end;
+        }
+        *count = written;
+    }
+
+    for (int i = 0; workers && i < threads; i++) {
+        kmp_free(workers[i].positions);
+    }
+    for (int n = 0; n < nodes; n++) {
+        kmp_release(replicas[n].replica);
+    }
+    kmp_free(workers);
+    kmp_free(handles);
+    kmp_free(started);
+
+    return positions;
+}
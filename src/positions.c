@@ -0,0 +1,317 @@
+#include "../include/kmp.h"
+
+#define KMP_POSITIONS_MAGIC "KMPPOS01"
+#define KMP_POSITIONS_HEADER 32
+
+/* Positions are split into blocks of KMP_POSITIONS_BLOCK. A block keeps its
+ * first position in block_first and the byte offset of its data in
+ * block_offsets; the data holds the remaining deltas as LEB128 varints, so
+ * any block decodes on its own and dense hits cost about one byte each. */
+
+KMPPositionList* kmp_positions_create(void) {
+    return (KMPPositionList*)kmp_calloc(1, sizeof(KMPPositionList));
+}
+
+void kmp_positions_destroy(KMPPositionList* list) {
+    if (list) {
+        kmp_free(list->data);
+        kmp_free(list->block_first);
+        kmp_free(list->block_offsets);
+        kmp_free(list);
+    }
+}
+
+static bool reserve_data(KMPPositionList* list, size_t extra) {
+    if (list->data_len + extra <= list->data_capacity) {
+        return true;
+    }
+    size_t capacity = list->data_capacity ? list->data_capacity : 256;
+    while (capacity < list->data_len + extra) {
+        capacity *= 2;
+    }
+    unsigned char* grown = (unsigned char*)kmp_realloc(list->data, capacity);
+    if (!grown) {
+        return false;
+    }
+    list->data = grown;
+    list->data_capacity = capacity;
+    return true;
+}
+
+static bool reserve_block(KMPPositionList* list) {
+    if (list->block_count < list->block_capacity) {
+        return true;
+    }
+    size_t capacity = list->block_capacity ? list->block_capacity * 2 : 16;
+    size_t* first = (size_t*)kmp_realloc(list->block_first, capacity * sizeof(size_t));
+    if (!first) {
+        return false;
+    }
+    list->block_first = first;
+    size_t* offsets = (size_t*)kmp_realloc(list->block_offsets, capacity * sizeof(size_t));
+    if (!offsets) {
+        return false;
+    }
+    list->block_offsets = offsets;
+    list->block_capacity = capacity;
+    return true;
+}
+
+/* Positions must be appended in non-decreasing order. */
+KMPError kmp_positions_append(KMPPositionList* list, size_t position) {
+    if (!list) {
+        return KMP_ERROR_NULL_POINTER;
+    }
+    if (list->count > 0 && position < list->last) {
+        return KMP_ERROR_INVALID_INPUT;
+    }
+
+    if (list->count % KMP_POSITIONS_BLOCK == 0) {
+        if (!reserve_block(list)) {
+            return KMP_ERROR_MEMORY_ALLOCATION;
+        }
+        list->block_first[list->block_count] = position;
+        list->block_offsets[list->block_count] = list->data_len;
+        list->block_count++;
+    } else {
+        if (!reserve_data(list, 10)) {
+            return KMP_ERROR_MEMORY_ALLOCATION;
+        }
+        size_t delta = position - list->last;
+        while (delta >= 0x80) {
+            list->data[list->data_len++] = (unsigned char)(delta | 0x80);
+            delta >>= 7;
+        }
+        list->data[list->data_len++] = (unsigned char)delta;
+    }
+
+    list->last = position;
+    list->count++;
+    return KMP_SUCCESS;
+}
+
+static size_t block_size(const KMPPositionList* list, size_t block) {
+    size_t remaining = list->count - block * KMP_POSITIONS_BLOCK;
+    return remaining < KMP_POSITIONS_BLOCK ? remaining : KMP_POSITIONS_BLOCK;
+}
+
+static size_t block_end(const KMPPositionList* list, size_t block) {
+    return block + 1 < list->block_count ? list->block_offsets[block + 1] : list->data_len;
+}
+
+static bool read_varint(const unsigned char* data, size_t end, size_t* offset, size_t* value) {
+    size_t result = 0;
+    unsigned shift = 0;
+    while (*offset < end && shift < 64) {
+        unsigned char byte = data[(*offset)++];
+        result |= (size_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+        shift += 7;
+    }
+    return false;
+}
+
+/* Decodes up to `limit` positions of one block into out; returns how many
+ * were decoded, which is less than requested only for corrupt data. */
+static size_t decode_block(const KMPPositionList* list, size_t block, size_t limit,
+                           size_t* out) {
+    size_t n = block_size(list, block);
+    if (limit < n) {
+        n = limit;
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    size_t offset = list->block_offsets[block];
+    size_t end = block_end(list, block);
+    size_t value = list->block_first[block];
+    out[0] = value;
+    for (size_t i = 1; i < n; i++) {
+        size_t delta;
+        if (!read_varint(list->data, end, &offset, &delta)) {
+            return i;
+        }
+        value += delta;
+        out[i] = value;
+    }
+    return n;
+}
+
+size_t kmp_positions_decode_block(const KMPPositionList* list, size_t block, size_t* out) {
+    if (!list || !out || block >= list->block_count) {
+        return 0;
+    }
+    return decode_block(list, block, KMP_POSITIONS_BLOCK, out);
+}
+
+KMPError kmp_positions_get(const KMPPositionList* list, size_t index, size_t* position) {
+    if (!list || !position) {
+        return KMP_ERROR_NULL_POINTER;
+    }
+    if (index >= list->count) {
+        return KMP_ERROR_INVALID_INPUT;
+    }
+
+    size_t values[KMP_POSITIONS_BLOCK];
+    size_t within = index % KMP_POSITIONS_BLOCK;
+    if (decode_block(list, index / KMP_POSITIONS_BLOCK, within + 1, values) != within + 1) {
+        return KMP_ERROR_INVALID_INPUT;
+    }
+    *position = values[within];
+    return KMP_SUCCESS;
+}
+
+size_t kmp_positions_memory(const KMPPositionList* list) {
+    if (!list) {
+        return 0;
+    }
+    return sizeof(KMPPositionList) + list->data_capacity +
+           list->block_capacity * 2 * sizeof(size_t);
+}
+
+void kmp_positions_iter_init(KMPPositionIter* iter, const KMPPositionList* list) {
+    if (iter) {
+        iter->list = list;
+        iter->index = 0;
+        iter->offset = 0;
+        iter->value = 0;
+    }
+}
+
+bool kmp_positions_next(KMPPositionIter* iter, size_t* position) {
+    if (!iter || !iter->list || !position || iter->index >= iter->list->count) {
+        return false;
+    }
+
+    const KMPPositionList* list = iter->list;
+    size_t block = iter->index / KMP_POSITIONS_BLOCK;
+    if (iter->index % KMP_POSITIONS_BLOCK == 0) {
+        iter->value = list->block_first[block];
+        iter->offset = list->block_offsets[block];
+    } else {
+        size_t delta;
+        if (!read_varint(list->data, block_end(list, block), &iter->offset, &delta)) {
+            return false;
+        }
+        iter->value += delta;
+    }
+
+    iter->index++;
+    *position = iter->value;
+    return true;
+}
+
+static void put_u64(unsigned char* p, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static uint64_t get_u64(const unsigned char* p) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= (uint64_t)p[i] << (8 * i);
+    }
+    return value;
+}
+
+/* Layout, all integers little-endian u64: magic, count, block count, data
+ * length, then block_first[], block_offsets[] and the varint data. */
+unsigned char* kmp_positions_serialize(const KMPPositionList* list, size_t* size) {
+    if (!list || !size) {
+        return NULL;
+    }
+
+    size_t total = KMP_POSITIONS_HEADER + list->block_count * 16 + list->data_len;
+    unsigned char* buffer = (unsigned char*)kmp_malloc(total);
+    if (!buffer) {
+        return NULL;
+    }
+
+    memcpy(buffer, KMP_POSITIONS_MAGIC, 8);
+    put_u64(buffer + 8, list->count);
+    put_u64(buffer + 16, list->block_count);
+    put_u64(buffer + 24, list->data_len);
+
+    unsigned char* p = buffer + KMP_POSITIONS_HEADER;
+    for (size_t b = 0; b < list->block_count; b++, p += 8) {
+        put_u64(p, list->block_first[b]);
+    }
+    for (size_t b = 0; b < list->block_count; b++, p += 8) {
+        put_u64(p, list->block_offsets[b]);
+    }
+    if (list->data_len) {
+        memcpy(p, list->data, list->data_len);
+    }
+
+    *size = total;
+    return buffer;
+}
+
+/* Rebuilds a list from kmp_positions_serialize() output. Every block is
+ * decoded once, so a truncated or corrupt buffer is rejected here rather
+ * than when it is read. */
+KMPPositionList* kmp_positions_deserialize(const unsigned char* buffer, size_t size) {
+    if (!buffer || size < KMP_POSITIONS_HEADER || memcmp(buffer, KMP_POSITIONS_MAGIC, 8) != 0) {
+        return NULL;
+    }
+
+    uint64_t count = get_u64(buffer + 8);
+    uint64_t blocks = get_u64(buffer + 16);
+    uint64_t data_len = get_u64(buffer + 24);
+    if (blocks != (count == 0 ? 0 : (count - 1) / KMP_POSITIONS_BLOCK + 1) ||
+        blocks > (size - KMP_POSITIONS_HEADER) / 16 ||
+        data_len != size - KMP_POSITIONS_HEADER - blocks * 16) {
+        return NULL;
+    }
+
+    KMPPositionList* list = kmp_positions_create();
+    if (!list) {
+        return NULL;
+    }
+    list->block_first = (size_t*)kmp_malloc((blocks ? blocks : 1) * sizeof(size_t));
+    list->block_offsets = (size_t*)kmp_malloc((blocks ? blocks : 1) * sizeof(size_t));
+    list->data = (unsigned char*)kmp_malloc(data_len ? data_len : 1);
+    if (!list->block_first || !list->block_offsets || !list->data) {
+        kmp_positions_destroy(list);
+        return NULL;
+    }
+    list->block_capacity = blocks;
+    list->data_capacity = data_len;
+
+    const unsigned char* p = buffer + KMP_POSITIONS_HEADER;
+    for (size_t b = 0; b < blocks; b++, p += 8) {
+        list->block_first[b] = get_u64(p);
+    }
+    for (size_t b = 0; b < blocks; b++, p += 8) {
+        list->block_offsets[b] = get_u64(p);
+    }
+    memcpy(list->data, p, data_len);
+    list->count = count;
+    list->block_count = blocks;
+    list->data_len = data_len;
+
+    for (size_t b = 0; b < blocks; b++) {
+        if (list->block_offsets[b] > data_len ||
+            (b > 0 && list->block_offsets[b] < list->block_offsets[b - 1])) {
+            kmp_positions_destroy(list);
+            return NULL;
+        }
+    }
+
+    size_t values[KMP_POSITIONS_BLOCK];
+    for (size_t b = 0; b < blocks; b++) {
+        if ((b > 0 && list->block_first[b] < list->last) ||
+            decode_block(list, b, KMP_POSITIONS_BLOCK, values) != block_size(list, b)) {
+            kmp_positions_destroy(list);
+            return NULL;
+        }
+        list->last = values[block_size(list, b) - 1];
+    }
+
+    return list;
+}
@@ -0,0 +1,214 @@
+#define _POSIX_C_SOURCE 200809L
+#include "kmp_internal.h"
+#include <errno.h>
+#include <unistd.h>
+
+#define KMP_REPLACE_CHUNK (64 * 1024)
+
+KMPReplacer* kmp_replacer_create(KMPMatcher* matcher, const char* replacement,
+                                 KMPOutputSink* sink) {
+    if (!matcher || !replacement || !sink) {
+        return NULL;
+    }
+
+    if (kmp_compile(matcher) != KMP_SUCCESS) {
+        return NULL;
+    }
+
+    KMPReplacer* replacer = (KMPReplacer*)kmp_malloc(sizeof(KMPReplacer));
+    if (!replacer) {
+        return NULL;
+    }
+
+    replacer->replacement = kmp_strdup(replacement);
+    if (!replacer->replacement) {
+        kmp_free(replacer);
+        return NULL;
+    }
+
+    replacer->matcher = kmp_retain(matcher);
+    replacer->replacement_len = strlen(replacement);
+    replacer->sink = sink;
+    replacer->matched = 0;
+    replacer->replacements = 0;
+    replacer->iov_count = 0;
+
+    return replacer;
+}
+
+void kmp_replacer_destroy(KMPReplacer* replacer) {
+    if (replacer) {
+        kmp_release(replacer->matcher);
+        kmp_free(replacer->replacement);
+        kmp_free(replacer);
+    }
+}
+
+static KMPError flush_iov(KMPReplacer* replacer) {
+    struct iovec* iov = replacer->iov;
+    int count = replacer->iov_count;
+
+    while (count > 0) {
+        ssize_t written = writev(replacer->sink->fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            replacer->iov_count = 0;
+            return KMP_ERROR_INVALID_INPUT;
+        }
+
+        replacer->sink->bytes_written += written;
+        while (count > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    replacer->iov_count = 0;
+    return KMP_SUCCESS;
+}
+
+static KMPError push_iov(KMPReplacer* replacer, const char* base, size_t len) {
+    if (len == 0) {
+        return KMP_SUCCESS;
+    }
+
+    if (replacer->iov_count == KMP_REPLACE_IOV_MAX) {
+        KMPError error = flush_iov(replacer);
+        if (error != KMP_SUCCESS) {
+            return error;
+        }
+    }
+
+    replacer->iov[replacer->iov_count].iov_base = (void*)base;
+    replacer->iov[replacer->iov_count].iov_len = len;
+    replacer->iov_count++;
+    return KMP_SUCCESS;
+}
+
+/* Emits the unchanged bytes [from, to), given relative to the current chunk.
+ * Negative offsets refer to the partial match carried over from earlier
+ * chunks; those bytes equal a pattern prefix, so they are emitted from the
+ * pattern itself and the old chunk never has to be kept. */
+static KMPError emit_span(KMPReplacer* replacer, const char* data, long carry,
+                          long from, long to) {
+    if (from >= to) {
+        return KMP_SUCCESS;
+    }
+
+    if (from < 0) {
+        long end = to < 0 ? to : 0;
+        KMPError error = push_iov(replacer, replacer->matcher->pattern + (from + carry),
+                                  (size_t)(end - from));
+        if (error != KMP_SUCCESS) {
+            return error;
+        }
+        from = 0;
+    }
+
+    return from < to ? push_iov(replacer, data + from, (size_t)(to - from)) : KMP_SUCCESS;
+}
+
+KMPError kmp_replacer_feed(KMPReplacer* replacer, const char* data, size_t len) {
+    if (!replacer || (!data && len > 0)) {
+        return KMP_ERROR_NULL_POINTER;
+    }
+
+    const char* pattern = replacer->matcher->pattern;
+    const int* lps = replacer->matcher->lps;
+    int m = replacer->matcher->pattern_len;
+    long carry = replacer->matched;
+    long emitted = -carry;
+    int j = replacer->matched;
+    KMPError error = KMP_SUCCESS;
+
+    for (size_t i = 0; i < len && error == KMP_SUCCESS; i++) {
+        char c = data[i];
+        while (j > 0 && pattern[j] != c) {
+            j = lps[j - 1];
+        }
+        if (pattern[j] == c) {
+            j++;
+        }
+        if (j == m) {
+            long end = (long)i + 1;
+            error = emit_span(replacer, data, carry, emitted, end - m);
+            if (error == KMP_SUCCESS) {
+                error = push_iov(replacer, replacer->replacement, replacer->replacement_len);
+            }
+            emitted = end;
+            replacer->replacements++;
+            j = 0;
+        }
+    }
+
+    if (error == KMP_SUCCESS) {
+        error = emit_span(replacer, data, carry, emitted, (long)len - j);
+    }
+    if (error == KMP_SUCCESS) {
+        error = flush_iov(replacer);
+    }
+
+    replacer->matched = j;
+    return error;
+}
+
+KMPError kmp_replacer_finish(KMPReplacer* replacer) {
+    if (!replacer) {
+        return KMP_ERROR_NULL_POINTER;
+    }
+
+    KMPError error = push_iov(replacer, replacer->matcher->pattern, replacer->matched);
+    replacer->matched = 0;
+    if (error == KMP_SUCCESS) {
+        error = flush_iov(replacer);
+    }
+    return error;
+}
+
+long long kmp_replace_stream(KMPMatcher* matcher, int input_fd,
+                             const char* replacement, KMPOutputSink* sink) {
+    KMPReplacer* replacer = kmp_replacer_create(matcher, replacement, sink);
+    char* buffer = (char*)kmp_malloc(KMP_REPLACE_CHUNK);
+    if (!replacer || !buffer) {
+        kmp_replacer_destroy(replacer);
+        kmp_free(buffer);
+        return -1;
+    }
+
+    KMPError error = KMP_SUCCESS;
+    for (;;) {
+        ssize_t got = read(input_fd, buffer, KMP_REPLACE_CHUNK);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = KMP_ERROR_INVALID_INPUT;
+            break;
+        }
+        if (got == 0) {
+            break;
+        }
+
+        error = kmp_replacer_feed(replacer, buffer, (size_t)got);
+        if (error != KMP_SUCCESS) {
+            break;
+        }
+    }
+
+    if (error == KMP_SUCCESS) {
+        error = kmp_replacer_finish(replacer);
+    }
+
+    long long replacements = (long long)replacer->replacements;
+    kmp_replacer_destroy(replacer);
+    kmp_free(buffer);
+
+    return error == KMP_SUCCESS ? replacements : -1;
+}
@@ -0,0 +1,74 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/kmp.h"
+#include <sched.h>
+
+void kmp_slot_init(KMPMatcherSlot* slot, KMPMatcher* matcher) {
+    if (!slot) {
+        return;
+    }
+
+    slot->current = kmp_retain(matcher);
+    slot->epoch = 0;
+    slot->readers[0] = 0;
+    slot->readers[1] = 0;
+    slot->writer_lock = 0;
+}
+
+/* Readers never wait: they announce themselves in the current epoch, take a
+ * reference and leave. The epoch is checked again after announcing, because
+ * a reader that counted itself in an epoch the publisher already flipped
+ * away from is not waited for by the next publish. The returned matcher
+ * must be released by the caller. */
+KMPMatcher* kmp_slot_acquire(KMPMatcherSlot* slot) {
+    if (!slot) {
+        return NULL;
+    }
+
+    int epoch;
+    for (;;) {
+        epoch = __atomic_load_n(&slot->epoch, __ATOMIC_SEQ_CST);
+        __atomic_fetch_add(&slot->readers[epoch], 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&slot->epoch, __ATOMIC_SEQ_CST) == epoch) {
+            break;
+        }
+        __atomic_fetch_sub(&slot->readers[epoch], 1, __ATOMIC_RELEASE);
+    }
+    KMPMatcher* matcher = kmp_retain(__atomic_load_n(&slot->current, __ATOMIC_SEQ_CST));
+    __atomic_fetch_sub(&slot->readers[epoch], 1, __ATOMIC_RELEASE);
+
+    return matcher;
+}
+
+/* Publishing swaps the pointer, then waits out readers that may have loaded
+ * the old pointer but not yet retained it. Searches already running hold their
+ * own reference and are never waited on. */
+void kmp_slot_publish(KMPMatcherSlot* slot, KMPMatcher* matcher) {
+    if (!slot) {
+        return;
+    }
+
+    while (__atomic_exchange_n(&slot->writer_lock, 1, __ATOMIC_ACQUIRE)) {
+        sched_yield();
+    }
+
+    KMPMatcher* old = __atomic_exchange_n(&slot->current, kmp_retain(matcher),
+                                          __ATOMIC_SEQ_CST);
+    int epoch = __atomic_load_n(&slot->epoch, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&slot->epoch, !epoch, __ATOMIC_SEQ_CST);
+
+    while (__atomic_load_n(&slot->readers[epoch], __ATOMIC_ACQUIRE) != 0) {
+        sched_yield();
+    }
+
+    __atomic_store_n(&slot->writer_lock, 0, __ATOMIC_RELEASE);
+    kmp_release(old);
+}
+
+void kmp_slot_destroy(KMPMatcherSlot* slot) {
+    if (!slot) {
+        return;
+    }
+
+    kmp_release(slot->current);
+    slot->current = NULL;
+}
@@ -0,0 +1,56 @@
+#include "../include/kmp.h"
+
+KMPStream* kmp_stream_create(KMPMatcher* matcher, KMPMatchCallback callback,
+                             void* user_data) {
+    if (!matcher) {
+        return NULL;
+    }
+
+    if (kmp_compile(matcher) != KMP_SUCCESS) {
+        return NULL;
+    }
+
+    KMPStream* stream = (KMPStream*)kmp_malloc(sizeof(KMPStream));
+    if (!stream) {
+        return NULL;
+    }
+
+    stream->matcher = kmp_retain(matcher);
+    stream->callback = callback;
+    stream->user_data = user_data;
+    stream->match_count = 0;
+    kmp_search_state_init(&stream->state);
+
+    return stream;
+}
+
+void kmp_stream_destroy(KMPStream* stream) {
+    if (stream) {
+        kmp_release(stream->matcher);
+        kmp_free(stream);
+    }
+}
+
+int kmp_append(KMPStream* stream, const char* bytes, size_t len) {
+    if (!stream) {
+        return -1;
+    }
+
+    int found = kmp_search_chunk(stream->matcher, &stream->state, bytes, len,
+                                 stream->callback, stream->user_data);
+    if (found > 0) {
+        stream->match_count += found;
+    }
+
+    return found;
+}
+
+void kmp_stream_reset(KMPStream* stream) {
+    if (stream) {
+        kmp_search_state_init(&stream->state);
+    }
+}
+
+size_t kmp_stream_offset(const KMPStream* stream) {
+    return stream ? stream->state.offset : 0;
+}
@@ -42,6 +42,14 @@ void kmp_print_stats(const KMPMatcher* matcher) {
     printf("Pattern: \"%s\"\n", matcher->pattern);
     printf("Pattern Length: %d\n", matcher->pattern_len);
     printf("Is Compiled: %s\n", matcher->is_compiled ? "Yes" : "No");
+    printf("Engine: %s\n", kmp_engine_name(matcher->engine));
+    if (matcher->is_compiled) {
+        printf("Period: %d\n", matcher->period);
+        printf("Entropy: %.2f bits/char\n", matcher->entropy);
+    }
+    if (matcher->text_alphabet > 0) {
+        printf("Sampled Text Alphabet: %d\n", matcher->text_alphabet);
+    }
     printf("Memory Usage: %zu bytes\n", matcher->memory_usage);
 
     if (matcher->is_compiled && matcher->lps) {
@@ -63,6 +71,10 @@ const char* kmp_error_string(KMPError error) {
             return "Memory allocation error";
         case KMP_ERROR_INVALID_INPUT:
             return "Invalid input error";
+        case KMP_ERROR_CANCELLED:
+            return "Search cancelled";
+        case KMP_ERROR_DEADLINE_EXCEEDED:
+            return "Search deadline exceeded";
         default:
             return "Unknown error";
     }
@@ -1,4 +1,17 @@
+#define _GNU_SOURCE
 #include "../include/kmp.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#ifdef KMP_HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 typedef struct {
     char* name;
@@ -38,6 +51,38 @@ char* generate_worst_case_text(const char* pattern, int text_length) {
     return text;
 }
 
+char* generate_periodic_string(int length, const char* period) {
+    int period_len = strlen(period);
+    char* str = (char*)malloc((length + 1) * sizeof(char));
+    if (!str) return NULL;
+
+    for (int i = 0; i < length; i++) {
+        str[i] = period[i % period_len];
+    }
+    str[length] = '\0';
+
+    return str;
+}
+
+char* generate_fibonacci_string(int length) {
+    char* str = (char*)malloc((length + 2) * sizeof(char));
+    if (!str) return NULL;
+
+    /* Prefix of the Fibonacci word, the fixed point of A -> AB, B -> A. */
+    str[0] = 'A';
+    str[1] = 'B';
+    int len = 2;
+    for (int read = 1; len < length; read++) {
+        str[len++] = 'A';
+        if (str[read] == 'A') {
+            str[len++] = 'B';
+        }
+    }
+    str[length] = '\0';
+
+    return str;
+}
+
 int naive_search(const char* text, const char* pattern) {
     int n = strlen(text);
     int m = strlen(pattern);
@@ -86,6 +131,25 @@ double benchmark_naive(const char* pattern, const char* text, int iterations) {
     return total_time / iterations;
 }
 
+double benchmark_engine(const char* pattern, const char* text, KMPEngine engine,
+                        int iterations, KMPEngine* chosen) {
+    KMPOptions options = {0, engine, text, strlen(text) < 4096 ? strlen(text) : 4096};
+    KMPMatcher* matcher = kmp_create_ex(pattern, &options);
+    if (!matcher) return -1.0;
+
+    if (chosen) *chosen = matcher->engine;
+
+    clock_t start = clock();
+    for (int i = 0; i < iterations; i++) {
+        int count;
+        kmp_free(kmp_search_all(matcher, text, &count));
+    }
+    clock_t end = clock();
+
+    kmp_destroy(matcher);
+    return measure_time(start, end) / iterations;
+}
+
 void run_single_benchmark(const char* name, const char* pattern,
                          const char* text, int iterations) {
     printf("\n=== %s ===\n", name);
@@ -205,6 +269,55 @@ void benchmark_worst_case() {
     }
 
     free(text);
+
+    int text_size = 1000000;
+    char* fibonacci = generate_fibonacci_string(text_size);
+    char* worst_text = generate_worst_case_text(pattern, text_size);
+    char* cascade_text = generate_periodic_string(text_size, "AAAAAAAAAAAAAAAC");
+    char* fibonacci_pattern = fibonacci ? (char*)malloc(234) : NULL;
+    if (fibonacci_pattern) {
+        memcpy(fibonacci_pattern, fibonacci, 232);
+        fibonacci_pattern[232] = 'B';
+        fibonacci_pattern[233] = '\0';
+    }
+
+    struct {
+        const char* name;
+        const char* pattern;
+        const char* text;
+    } inputs[] = {
+        {"A..AB", pattern, worst_text},
+        {"A^15 B", "AAAAAAAAAAAAAAAB", cascade_text},
+        {"Fibonacci", fibonacci_pattern, fibonacci}
+    };
+    int num_inputs = sizeof(inputs) / sizeof(inputs[0]);
+
+    printf("\nComparisons per text byte (text size %d)\n", text_size);
+    printf("%-12s %-10s %-10s %-12s %-12s\n",
+           "Input", "LPS", "Strong", "LPS (ms)", "Strong (ms)");
+    printf("----------------------------------------------------------\n");
+    for (int k = 0; k < num_inputs; k++) {
+        if (!inputs[k].pattern || !inputs[k].text) continue;
+
+        KMPOptions lps_options = {0, KMP_ENGINE_LPS, NULL, 0};
+        KMPOptions strong_options = {0, KMP_ENGINE_STRONG, NULL, 0};
+        KMPMatcher* lps = kmp_create_ex(inputs[k].pattern, &lps_options);
+        KMPMatcher* strong = kmp_create_ex(inputs[k].pattern, &strong_options);
+        if (lps && strong) {
+            printf("%-12s %-10.3f %-10.3f %-12.3f %-12.3f\n", inputs[k].name,
+                   (double)kmp_count_comparisons(lps, inputs[k].text, text_size) / text_size,
+                   (double)kmp_count_comparisons(strong, inputs[k].text, text_size) / text_size,
+                   benchmark_engine(inputs[k].pattern, inputs[k].text, KMP_ENGINE_LPS, 5, NULL),
+                   benchmark_engine(inputs[k].pattern, inputs[k].text, KMP_ENGINE_STRONG, 5, NULL));
+        }
+        kmp_destroy(lps);
+        kmp_destroy(strong);
+    }
+
+    free(fibonacci);
+    free(fibonacci_pattern);
+    free(worst_text);
+    free(cascade_text);
 }
 
 void benchmark_alphabet_size() {
@@ -237,26 +350,855 @@ void benchmark_alphabet_size() {
     }
 }
 
+void benchmark_lps_construction() {
+    printf("\n=== Benchmark: Failure Table Construction ===\n");
+
+    int lengths[] = {1000, 100000, 1000000, 10000000};
+    int num_lengths = sizeof(lengths) / sizeof(lengths[0]);
+    const char* kinds[] = {"random", "periodic AB", "unary A..AB"};
+
+    printf("%-10s %-13s %-15s %-15s %-10s\n",
+           "Length", "Pattern", "LPS (ms)", "LPS+strong (ms)", "ns/char");
+    printf("------------------------------------------------------------------\n");
+
+    for (int i = 0; i < num_lengths; i++) {
+        int len = lengths[i];
+        int* lps = (int*)malloc(len * sizeof(int));
+        int* strong = (int*)malloc(len * sizeof(int));
+        if (!lps || !strong) {
+            free(lps);
+            free(strong);
+            continue;
+        }
+
+        for (int k = 0; k < 3; k++) {
+            char* pattern;
+            if (k == 0) {
+                pattern = generate_random_string(len, 4);
+            } else if (k == 1) {
+                pattern = generate_periodic_string(len, "AB");
+            } else {
+                pattern = generate_periodic_string(len, "A");
+                if (pattern) pattern[len - 1] = 'B';
+            }
+            if (!pattern) continue;
+
+            clock_t start = clock();
+            int* table = compute_lps_table(pattern, len);
+            clock_t end = clock();
+            double lps_time = measure_time(start, end);
+            kmp_free(table);
+
+            start = clock();
+            kmp_build_failure_tables(pattern, len, lps, strong);
+            end = clock();
+            double both_time = measure_time(start, end);
+
+            printf("%-10d %-13s %-15.3f %-15.3f %-10.2f\n",
+                   len, kinds[k], lps_time, both_time, both_time * 1e6 / len);
+
+            free(pattern);
+        }
+
+        free(lps);
+        free(strong);
+    }
+}
+
+void benchmark_engine_matrix() {
+    printf("\n=== Benchmark: Engine Matrix ===\n");
+
+    int text_size = 1000000;
+    char* dna_text = generate_random_string(text_size, 4);
+    char* latin_text = generate_random_string(text_size, 26);
+    char* periodic_text = generate_periodic_string(text_size, "AB");
+    char* worst_text = generate_worst_case_text("AAAAAAB", text_size);
+    char* long_pattern = latin_text ? (char*)malloc(65) : NULL;
+    if (long_pattern) {
+        memcpy(long_pattern, latin_text + text_size / 2, 64);
+        long_pattern[64] = '\0';
+    }
+
+    struct {
+        const char* name;
+        const char* pattern;
+        const char* text;
+    } scenarios[] = {
+        {"dna m=7", "ACGTACG", dna_text},
+        {"latin m=1", "Q", latin_text},
+        {"latin m=8", "QWERTYUI", latin_text},
+        {"latin m=64", long_pattern, latin_text},
+        {"periodic ABAB", "ABABABAB", periodic_text},
+        {"worst A..AB", "AAAAAAB", worst_text}
+    };
+    int num_scenarios = sizeof(scenarios) / sizeof(scenarios[0]);
+    KMPEngine engines[] = {KMP_ENGINE_LPS, KMP_ENGINE_DFA, KMP_ENGINE_HORSPOOL, KMP_ENGINE_MEMMEM,
+                           KMP_ENGINE_STRONG};
+
+    printf("Text size: %d (times in ms per kmp_search_all)\n", text_size);
+    printf("%-15s %-9s %-9s %-9s %-9s %-9s %-18s %-8s\n",
+           "Scenario", "LPS", "DFA", "Horspool", "memmem", "Strong", "Planner", "vs best");
+    printf("-----------------------------------------------------------------------------------------\n");
+
+    for (int s = 0; s < num_scenarios; s++) {
+        if (!scenarios[s].pattern || !scenarios[s].text) continue;
+
+        double best = -1.0;
+        printf("%-15s ", scenarios[s].name);
+        for (int e = 0; e < 5; e++) {
+            double t = benchmark_engine(scenarios[s].pattern, scenarios[s].text, engines[e], 5, NULL);
+            if (t >= 0 && (best < 0 || t < best)) best = t;
+            if (t >= 0) {
+                printf("%-9.3f ", t);
+            } else {
+                printf("%-9s ", "n/a");
+            }
+        }
+
+        KMPEngine chosen = KMP_ENGINE_AUTO;
+        double planned = benchmark_engine(scenarios[s].pattern, scenarios[s].text,
+                                          KMP_ENGINE_AUTO, 5, &chosen);
+        char label[32];
+        sprintf(label, "%.3f (%s)", planned, kmp_engine_name(chosen));
+        printf("%-18s %-8.2f\n", label, best > 0 ? planned / best : 1.0);
+    }
+
+    free(dna_text);
+    free(latin_text);
+    free(periodic_text);
+    free(worst_text);
+    free(long_pattern);
+}
+
+void benchmark_index_vs_scan() {
+    printf("\n=== Benchmark: Suffix Array Index vs Linear Scan ===\n");
+
+    int text_size = 8000000;
+    int queries = 200;
+    char* text = generate_random_string(text_size, 26);
+    if (!text) return;
+
+    clock_t start = clock();
+    KMPIndex* index = kmp_index_build(text, text_size);
+    clock_t end = clock();
+    double build_time = measure_time(start, end);
+    if (!index) {
+        free(text);
+        return;
+    }
+
+    char patterns[200][9];
+    for (int q = 0; q < queries; q++) {
+        memcpy(patterns[q], text + (rand() % (text_size - 8)), 8);
+        patterns[q][8] = '\0';
+    }
+
+    start = clock();
+    long long index_hits = 0;
+    for (int q = 0; q < queries; q++) {
+        int count;
+        kmp_free(kmp_index_locate(index, patterns[q], 8, &count));
+        index_hits += count;
+    }
+    end = clock();
+    double index_time = measure_time(start, end) / queries;
+
+    int scan_queries = 20;
+    start = clock();
+    for (int q = 0; q < scan_queries; q++) {
+        KMPMatcher* matcher = kmp_create(patterns[q]);
+        int count;
+        kmp_free(kmp_search_all(matcher, text, &count));
+        kmp_destroy(matcher);
+    }
+    end = clock();
+    double scan_time = measure_time(start, end) / scan_queries;
+
+    printf("Text size: %d, pattern length: 8, matches found: %lld\n", text_size, index_hits);
+    printf("Index build: %.3f ms (%.1f bytes/char)\n", build_time,
+           (double)index->memory_usage / text_size);
+    printf("Per query: index %.6f ms, linear scan %.3f ms\n", index_time, scan_time);
+    printf("%-10s %-18s %-18s\n", "Queries", "Index total (ms)", "Scan total (ms)");
+    printf("----------------------------------------------\n");
+    int counts[] = {1, 10, 100, 1000};
+    for (int i = 0; i < 4; i++) {
+        printf("%-10d %-18.3f %-18.3f\n", counts[i],
+               build_time + counts[i] * index_time, counts[i] * scan_time);
+    }
+    if (scan_time > index_time) {
+        printf("Index overtakes scanning after %.1f queries\n",
+               build_time / (scan_time - index_time));
+    }
+
+    kmp_index_destroy(index);
+    free(text);
+}
+
+void benchmark_packed_dna() {
+    printf("\n=== Benchmark: Packed 2-bit DNA vs Byte KMP ===\n");
+
+    int text_size = 32000000;
+    char* text = generate_random_string(text_size, 4);
+    if (!text) return;
+    for (int i = 0; i < text_size; i++) {
+        text[i] = "ACGT"[text[i] - 'A'];
+    }
+
+    clock_t start = clock();
+    KMPPackedSeq* packed = kmp_packed_from_string(text, text_size);
+    clock_t end = clock();
+    if (!packed) {
+        free(text);
+        return;
+    }
+
+    printf("Bases: %d, byte text %.1f MB, packed %.1f MB, pack time %.3f ms\n",
+           text_size, text_size / 1048576.0,
+           packed->word_count * sizeof(uint64_t) / 1048576.0, measure_time(start, end));
+    printf("%-10s %-16s %-16s %-10s %-10s\n",
+           "Pattern", "Byte KMP (ms)", "Packed (ms)", "Speedup", "Matches");
+    printf("------------------------------------------------------------------\n");
+
+    int lengths[] = {8, 16, 32, 64};
+    for (int k = 0; k < 4; k++) {
+        char pattern[65];
+        memcpy(pattern, text + text_size / 2, lengths[k]);
+        pattern[lengths[k]] = '\0';
+
+        KMPMatcher* matcher = kmp_create(pattern);
+        int byte_count;
+        start = clock();
+        kmp_free(kmp_search_all(matcher, text, &byte_count));
+        end = clock();
+        double byte_time = measure_time(start, end);
+        kmp_destroy(matcher);
+
+        KMPPackedSeq* packed_pattern = kmp_packed_from_string(pattern, lengths[k]);
+        size_t packed_count;
+        start = clock();
+        kmp_free(kmp_packed_search_all(packed, packed_pattern, &packed_count));
+        end = clock();
+        double packed_time = measure_time(start, end);
+        kmp_packed_destroy(packed_pattern);
+
+        printf("%-10d %-16.3f %-16.3f %-10.2f %d/%zu\n", lengths[k], byte_time,
+               packed_time, packed_time > 0 ? byte_time / packed_time : 0.0,
+               byte_count, packed_count);
+    }
+    kmp_packed_destroy(packed);
+
+    /* Every window of a run passes the 32-base filter, so this is the case
+     * where long patterns lean entirely on the KMP verifier. */
+    memset(text, 'A', text_size);
+    packed = kmp_packed_from_string(text, text_size);
+    char runs_pattern[65];
+    memset(runs_pattern, 'A', 63);
+    runs_pattern[63] = 'C';
+    runs_pattern[64] = '\0';
+    if (packed) {
+        KMPMatcher* matcher = kmp_create(runs_pattern);
+        int byte_count;
+        start = clock();
+        kmp_free(kmp_search_all(matcher, text, &byte_count));
+        end = clock();
+        double byte_time = measure_time(start, end);
+        kmp_destroy(matcher);
+
+        KMPPackedSeq* packed_pattern = kmp_packed_from_string(runs_pattern, 64);
+        size_t packed_count;
+        start = clock();
+        kmp_free(kmp_packed_search_all(packed, packed_pattern, &packed_count));
+        end = clock();
+        double packed_time = measure_time(start, end);
+        kmp_packed_destroy(packed_pattern);
+
+        printf("%-10s %-16.3f %-16.3f %-10.2f %d/%zu\n", "A^63C/A*", byte_time,
+               packed_time, packed_time > 0 ? byte_time / packed_time : 0.0,
+               byte_count, packed_count);
+    }
+
+    kmp_packed_destroy(packed);
+    free(text);
+}
+
+void benchmark_multi_pattern() {
+    printf("\n=== Benchmark: Multi-Pattern SIMD Engine vs One Matcher per Pattern ===\n");
+
+    int text_size = 8000000;
+    char* text = generate_random_string(text_size, 26);
+    if (!text) return;
+
+    char patterns[64][13];
+    const char* pattern_ptrs[64];
+    for (int p = 0; p < 64; p++) {
+        int len = 4 + p % 9;
+        memcpy(patterns[p], text + (size_t)rand() % (text_size - 16), len);
+        patterns[p][len] = '\0';
+        pattern_ptrs[p] = patterns[p];
+    }
+
+    printf("Text size: %d, pattern lengths 4-12, SIMD available: %s\n", text_size,
+           kmp_multi_simd_available() ? "AVX2" : "no");
+    printf("%-10s %-16s %-16s %-14s %-14s %-10s\n", "Patterns", "Per-pattern (ms)",
+           "Per-pattern auto", "Multi scalar", "Multi SIMD", "Matches");
+    printf("------------------------------------------------------------------------------------\n");
+
+    int sizes[] = {8, 16, 32, 64};
+    for (int k = 0; k < 4; k++) {
+        int n = sizes[k];
+        size_t separate_matches = 0;
+        clock_t start = clock();
+        for (int p = 0; p < n; p++) {
+            KMPMatcher* matcher = kmp_create(pattern_ptrs[p]);
+            int count;
+            kmp_free(kmp_search_all(matcher, text, &count));
+            separate_matches += count;
+            kmp_destroy(matcher);
+        }
+        clock_t end = clock();
+        double separate_time = measure_time(start, end);
+
+        KMPOptions automatic = {0, KMP_ENGINE_AUTO, NULL, 0};
+        start = clock();
+        for (int p = 0; p < n; p++) {
+            KMPMatcher* matcher = kmp_create_ex(pattern_ptrs[p], &automatic);
+            int count;
+            kmp_free(kmp_search_all(matcher, text, &count));
+            kmp_destroy(matcher);
+        }
+        end = clock();
+        double auto_time = measure_time(start, end);
+
+        KMPMultiMatcher* multi = kmp_multi_create(pattern_ptrs, n);
+        if (!multi) continue;
+
+        size_t multi_matches;
+        multi->use_simd = false;
+        start = clock();
+        kmp_free(kmp_multi_search_all(multi, text, text_size, &multi_matches));
+        end = clock();
+        double scalar_time = measure_time(start, end);
+
+        double simd_time = -1.0;
+        if (kmp_multi_simd_available()) {
+            multi->use_simd = true;
+            start = clock();
+            kmp_free(kmp_multi_search_all(multi, text, text_size, &multi_matches));
+            end = clock();
+            simd_time = measure_time(start, end);
+        }
+
+        char simd_label[32];
+        if (simd_time >= 0) {
+            sprintf(simd_label, "%.3f", simd_time);
+        } else {
+            sprintf(simd_label, "n/a");
+        }
+        printf("%-10d %-16.3f %-16.3f %-14.3f %-14s %zu/%zu\n", n, separate_time, auto_time,
+               scalar_time, simd_label, separate_matches, multi_matches);
+        kmp_multi_destroy(multi);
+    }
+
+    free(text);
+}
+
+void benchmark_compressed_positions() {
+    printf("\n=== Benchmark: Compressed Match Positions ===\n");
+
+    int text_size = 50000000;
+    char* text = generate_random_string(text_size, 4);
+    if (!text) return;
+
+    const char* patterns[] = {"A", "AB", "ABCD"};
+    printf("Text size: %d\n", text_size);
+    printf("%-8s %-10s %-14s %-14s %-10s %-12s %-12s\n", "Pattern", "Matches",
+           "int[] (MB)", "Packed (MB)", "Bytes/hit", "int[] (ms)", "Packed (ms)");
+    printf("-------------------------------------------------------------------------------\n");
+
+    for (int k = 0; k < 3; k++) {
+        KMPMatcher* matcher = kmp_create(patterns[k]);
+
+        clock_t start = clock();
+        int count;
+        int* positions = kmp_search_all(matcher, text, &count);
+        clock_t end = clock();
+        double flat_time = measure_time(start, end);
+        kmp_free(positions);
+
+        start = clock();
+        KMPPositionList* list = kmp_search_all_compressed(matcher, text);
+        end = clock();
+        double packed_time = measure_time(start, end);
+
+        if (list) {
+            size_t bytes = kmp_positions_memory(list);
+            printf("%-8s %-10d %-14.1f %-14.1f %-10.2f %-12.3f %-12.3f\n", patterns[k], count,
+                   count * sizeof(int) / 1048576.0, bytes / 1048576.0,
+                   list->count ? (double)bytes / list->count : 0.0, flat_time, packed_time);
+
+            size_t sum = 0;
+            size_t position;
+            KMPPositionIter iter;
+            kmp_positions_iter_init(&iter, list);
+            start = clock();
+            while (kmp_positions_next(&iter, &position)) {
+                sum += position;
+            }
+            end = clock();
+            if (k == 0) {
+                printf("Iterator decode: %.3f ms for %zu positions (checksum %zu)\n",
+                       measure_time(start, end), list->count, sum);
+            }
+        }
+
+        kmp_positions_destroy(list);
+        kmp_destroy(matcher);
+    }
+
+    free(text);
+}
+
+void benchmark_numa_parallel() {
+    printf("\n=== Benchmark: NUMA-Aware Parallel Scan ===\n");
+
+    int text_size = 128 * 1024 * 1024;
+    char* source = generate_random_string(text_size, 26);
+    if (!source) return;
+
+    clock_t start = clock();
+    KMPNumaText* text = kmp_numa_text_create(source, text_size);
+    clock_t end = clock();
+    if (!text) {
+        free(source);
+        return;
+    }
+
+    const KMPTopology* topology = &text->topology;
+    printf("Nodes: %d, text %d MB placed in %.3f ms\n", topology->node_count,
+           text_size / (1024 * 1024), measure_time(start, end));
+
+    KMPMatcher* matcher = kmp_create("QWERTY");
+    KMPSearchOptions whole = {0, 0, NULL, 0};
+    KMPSearchState cursor;
+    size_t* positions;
+    size_t single_count;
+    kmp_search_state_init(&cursor);
+    uint64_t begin = kmp_now_ns();
+    kmp_search_range(matcher, source, text_size, &whole, &cursor, &positions, &single_count);
+    double single_seconds = (kmp_now_ns() - begin) / 1e9;
+    kmp_free(positions);
+
+    KMPParallelStats stats;
+    size_t count;
+    begin = kmp_now_ns();
+    positions = kmp_parallel_search_all(matcher, text, 0, &count, &stats);
+    double parallel_seconds = (kmp_now_ns() - begin) / 1e9;
+    kmp_free(positions);
+
+    printf("Single thread: %.2f GB/s, parallel: %.2f GB/s (%zu/%zu matches)\n",
+           text_size / single_seconds / 1e9, text_size / parallel_seconds / 1e9,
+           single_count, count);
+    printf("%-8s %-8s %-12s %-12s %-10s\n", "Node", "Threads", "Bytes (MB)", "Time (ms)", "GB/s");
+    printf("--------------------------------------------------\n");
+    for (int n = 0; n < stats.node_count; n++) {
+        printf("%-8d %-8d %-12.1f %-12.3f %-10.2f\n", stats.node_ids[n], stats.node_threads[n],
+               stats.node_bytes[n] / 1048576.0, stats.node_ns[n] / 1e6,
+               stats.node_ns[n] ? stats.node_bytes[n] / (double)stats.node_ns[n] : 0.0);
+    }
+    if (stats.node_count == 1) {
+        printf("Single NUMA node: per-node placement has no remote memory to avoid\n");
+    }
+
+    kmp_destroy(matcher);
+    kmp_numa_text_destroy(text);
+    free(source);
+}
+
+long long copy_replace(const char* path, const char* pattern, const char* replacement,
+                       int out_fd) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return -1;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    char* text = (char*)malloc(size + 1);
+    if (!text || fread(text, 1, size, file) != (size_t)size) {
+        free(text);
+        fclose(file);
+        return -1;
+    }
+    text[size] = '\0';
+    fclose(file);
+
+    KMPMatcher* matcher = kmp_create(pattern);
+    int count;
+    int* positions = kmp_search_all(matcher, text, &count);
+    int m = strlen(pattern);
+    int r = strlen(replacement);
+
+    char* output = (char*)malloc(size + (size_t)count * (r > m ? r - m : 0) + 1);
+    long long replaced = 0;
+    if (output) {
+        long in = 0;
+        size_t out = 0;
+        for (int i = 0; i < count; i++) {
+            if (positions[i] < in) continue;
+            memcpy(output + out, text + in, positions[i] - in);
+            out += positions[i] - in;
+            memcpy(output + out, replacement, r);
+            out += r;
+            in = positions[i] + m;
+            replaced++;
+        }
+        memcpy(output + out, text + in, size - in);
+        out += size - in;
+        if (write(out_fd, output, out) != (ssize_t)out) replaced = -1;
+    }
+
+    free(output);
+    kmp_free(positions);
+    kmp_destroy(matcher);
+    free(text);
+    return replaced;
+}
+
+void benchmark_stream_replace() {
+    printf("\n=== Benchmark: Streaming Replace ===\n");
+
+    const char* path = "/tmp/kmp_replace_bench.txt";
+    int text_size = 64 * 1024 * 1024;
+    char* text = generate_random_string(text_size, 26);
+    if (!text) return;
+    for (int i = 0; i + 6 < text_size; i += 1000) {
+        memcpy(text + i, "NEEDLE", 6);
+    }
+
+    FILE* file = fopen(path, "wb");
+    if (!file || fwrite(text, 1, text_size, file) != (size_t)text_size) {
+        if (file) fclose(file);
+        free(text);
+        return;
+    }
+    fclose(file);
+    free(text);
+
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd < 0) return;
+
+    uint64_t start = kmp_now_ns();
+    long long baseline = copy_replace(path, "NEEDLE", "pin", null_fd);
+    double baseline_ms = (kmp_now_ns() - start) / 1e6;
+
+    int in_fd = open(path, O_RDONLY);
+    KMPMatcher* matcher = kmp_create("NEEDLE");
+    KMPOutputSink sink = {null_fd, 0};
+    start = kmp_now_ns();
+    long long streamed = kmp_replace_stream(matcher, in_fd, "pin", &sink);
+    double stream_ms = (kmp_now_ns() - start) / 1e6;
+    kmp_destroy(matcher);
+    close(in_fd);
+
+    start = kmp_now_ns();
+    int sed_status = system("sed 's/NEEDLE/pin/g' /tmp/kmp_replace_bench.txt > /dev/null 2>&1");
+    double sed_ms = (kmp_now_ns() - start) / 1e6;
+
+    printf("Input: %d MB, replacements: %lld\n", text_size / (1024 * 1024), streamed);
+    printf("%-32s %-12s %-10s\n", "Method", "Time (ms)", "MB/s");
+    printf("--------------------------------------------------------\n");
+    printf("%-32s %-12.1f %-10.0f\n", "load + search_all + copy", baseline_ms,
+           text_size / 1048576.0 / (baseline_ms / 1000.0));
+    printf("%-32s %-12.1f %-10.0f\n", "kmp_replace_stream (writev)", stream_ms,
+           text_size / 1048576.0 / (stream_ms / 1000.0));
+    if (sed_status == 0) {
+        printf("%-32s %-12.1f %-10.0f\n", "sed s///g", sed_ms,
+               text_size / 1048576.0 / (sed_ms / 1000.0));
+    }
+    if (baseline != streamed) {
+        printf("Warning: replacement counts differ (%lld vs %lld)\n", baseline, streamed);
+    }
+
+    close(null_fd);
+    unlink(path);
+}
+
+#ifdef KMP_HAVE_ZLIB
+static void count_match(size_t position, void* user_data) {
+    (void)position;
+    (*(long long*)user_data)++;
+}
+
+/* The old pipeline: inflate to a file on disk, read it back, search it. */
+static long long decompress_then_search(const char* gz_path, const char* plain_path,
+                                        const char* pattern) {
+    gzFile in = gzopen(gz_path, "rb");
+    FILE* out = fopen(plain_path, "wb");
+    char* buffer = (char*)malloc(1 << 20);
+    long long total = 0;
+    int got = 0;
+    while (in && out && buffer && (got = gzread(in, buffer, 1 << 20)) > 0) {
+        if (fwrite(buffer, 1, got, out) != (size_t)got) {
+            got = -1;
+            break;
+        }
+        total += got;
+    }
+    if (in) gzclose(in);
+    if (out) fclose(out);
+    free(buffer);
+    if (got < 0 || !in || !out) return -1;
+
+    char* text = (char*)malloc(total + 1);
+    FILE* plain = fopen(plain_path, "rb");
+    long long matches = -1;
+    if (text && plain && fread(text, 1, total, plain) == (size_t)total) {
+        text[total] = '\0';
+        KMPMatcher* matcher = kmp_create(pattern);
+        int count;
+        kmp_free(kmp_search_all(matcher, text, &count));
+        kmp_destroy(matcher);
+        matches = count;
+    }
+    if (plain) fclose(plain);
+    free(text);
+    unlink(plain_path);
+    return matches;
+}
+
+void benchmark_compressed_search() {
+    printf("\n=== Benchmark: Search over gzip Input ===\n");
+
+    const char* gz_path = "/tmp/kmp_compressed_bench.log.gz";
+    const char* plain_path = "/tmp/kmp_compressed_bench.log";
+    const char* levels[] = {"INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR"};
+    size_t text_size = 128 * 1024 * 1024;
+    char* text = (char*)malloc(text_size + 128);
+    if (!text) return;
+
+    srand(42);
+    size_t len = 0;
+    while (len < text_size) {
+        len += sprintf(text + len, "2024-05-%02d %02d:%02d:%02d %s request=%d latency=%dms\n",
+                       1 + rand() % 28, rand() % 24, rand() % 60, rand() % 60,
+                       levels[rand() % 6], rand() % 100000, rand() % 500);
+    }
+
+    gzFile out = gzopen(gz_path, "wb6");
+    bool written = out && gzwrite(out, text, (unsigned)len) == (int)len;
+    if (out) gzclose(out);
+    free(text);
+    if (!written) return;
+
+    uint64_t start = kmp_now_ns();
+    long long baseline = decompress_then_search(gz_path, plain_path, "ERROR");
+    double baseline_ms = (kmp_now_ns() - start) / 1e6;
+
+    FILE* in = fopen(gz_path, "rb");
+    KMPMatcher* matcher = kmp_create("ERROR");
+    long long streamed = 0;
+    start = kmp_now_ns();
+    long long found = in ? kmp_search_compressed(matcher, fileno(in), KMP_COMPRESSION_AUTO,
+                                                 count_match, &streamed) : -1;
+    double stream_ms = (kmp_now_ns() - start) / 1e6;
+    kmp_destroy(matcher);
+    if (in) fclose(in);
+
+    printf("Uncompressed: %zu MB, matches: %lld\n", len / (1024 * 1024), found);
+    printf("%-34s %-12s %-10s\n", "Method", "Time (ms)", "MB/s");
+    printf("--------------------------------------------------------\n");
+    printf("%-34s %-12.1f %-10.0f\n", "gunzip to disk + kmp_search_all", baseline_ms,
+           len / 1048576.0 / (baseline_ms / 1000.0));
+    printf("%-34s %-12.1f %-10.0f\n", "kmp_search_compressed", stream_ms,
+           len / 1048576.0 / (stream_ms / 1000.0));
+    if (baseline != found || found != streamed) {
+        printf("Warning: match counts differ (%lld vs %lld)\n", baseline, found);
+    }
+
+    unlink(gz_path);
+}
+#endif
+
+/* Counts user-space dTLB load misses of this thread; -1 when perf events
+ * are unavailable (no PMU, a container, or perf_event_paranoid). */
+static int open_dtlb_counter(void) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+static void start_dtlb_counter(int fd) {
+#ifdef __linux__
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    (void)fd;
+#endif
+}
+
+static long long stop_dtlb_counter(int fd) {
+    long long misses = -1;
+#ifdef __linux__
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &misses, sizeof(misses)) != (ssize_t)sizeof(misses)) {
+            misses = -1;
+        }
+    }
+#else
+    (void)fd;
+#endif
+    return misses;
+}
+
+static long long anon_huge_kb(void) {
+    FILE* smaps = fopen("/proc/self/smaps_rollup", "r");
+    if (!smaps) return -1;
+    char line[256];
+    long long kb = -1;
+    while (fgets(line, sizeof(line), smaps)) {
+        if (sscanf(line, "AnonHugePages: %lld kB", &kb) == 1) break;
+    }
+    fclose(smaps);
+    return kb;
+}
+
+static void print_huge_page_row(const char* workload, bool huge, double ms, double rate,
+                                const char* unit, long long misses, long long huge_kb) {
+    char miss_label[32];
+    char huge_label[32];
+    if (misses >= 0) {
+        snprintf(miss_label, sizeof(miss_label), "%lld", misses);
+    } else {
+        snprintf(miss_label, sizeof(miss_label), "n/a");
+    }
+    if (huge_kb >= 0) {
+        snprintf(huge_label, sizeof(huge_label), "%lld", huge_kb / 1024);
+    } else {
+        snprintf(huge_label, sizeof(huge_label), "n/a");
+    }
+    printf("%-16s %-6s %-12.1f %8.1f %-10s %-14s %-10s\n", workload, huge ? "on" : "off", ms,
+           rate, unit, miss_label, huge_label);
+}
+
+void benchmark_huge_pages() {
+    printf("\n=== Benchmark: Huge Page Backed Buffers ===\n");
+
+    char mode[64] = "n/a";
+    FILE* thp = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (thp) {
+        if (!fgets(mode, sizeof(mode), thp)) snprintf(mode, sizeof(mode), "n/a");
+        mode[strcspn(mode, "\n")] = '\0';
+        fclose(thp);
+    }
+    int dtlb = open_dtlb_counter();
+    printf("THP mode: %s; dTLB counter: %s\n", mode, dtlb >= 0 ? "perf_event" : "n/a");
+
+    size_t scan_size = 256 * 1024 * 1024;
+    int index_size = 16 * 1024 * 1024;
+    int queries = 200000;
+    printf("%-16s %-6s %-12s %-19s %-14s %-10s\n", "Workload", "Huge", "Time (ms)",
+           "Throughput", "dTLB misses", "THP (MB)");
+    printf("-------------------------------------------------------------------------------\n");
+
+    for (int pass = 0; pass < 2; pass++) {
+        bool huge = pass == 1;
+        kmp_huge_pages_enable(huge);
+
+        /* Allocated after toggling, so only the second pass is advised. */
+        char* text = (char*)kmp_malloc(scan_size + 1);
+        if (!text) break;
+        srand(7);
+        for (size_t i = 0; i < scan_size; i++) {
+            text[i] = "ACGT"[rand() % 4];
+        }
+        text[scan_size] = '\0';
+        long long huge_kb = anon_huge_kb();
+
+        KMPMatcher* matcher = kmp_create("ACGTACGTAC");
+        int count;
+        start_dtlb_counter(dtlb);
+        uint64_t start = kmp_now_ns();
+        kmp_free(kmp_search_all(matcher, text, &count));
+        double ms = (kmp_now_ns() - start) / 1e6;
+        long long misses = stop_dtlb_counter(dtlb);
+        print_huge_page_row("kmp_search_all", huge, ms, scan_size / 1048576.0 / (ms / 1000.0),
+                            "MB/s", misses, huge_kb);
+        kmp_destroy(matcher);
+        kmp_free(text);
+
+        /* Binary search over a suffix array touches a new page per probe. */
+        text = (char*)kmp_malloc(index_size + 1);
+        if (!text) break;
+        for (int i = 0; i < index_size; i++) {
+            text[i] = 'a' + rand() % 26;
+        }
+        text[index_size] = '\0';
+        KMPIndex* index = kmp_index_build(text, index_size);
+        if (index) {
+            huge_kb = anon_huge_kb();
+            long long hits = 0;
+            start_dtlb_counter(dtlb);
+            start = kmp_now_ns();
+            for (int q = 0; q < queries; q++) {
+                hits += kmp_index_count(index, text + rand() % (index_size - 12), 12);
+            }
+            ms = (kmp_now_ns() - start) / 1e6;
+            misses = stop_dtlb_counter(dtlb);
+            print_huge_page_row("kmp_index_count", huge, ms, queries / 1000.0 / (ms / 1000.0),
+                                "kq/s", misses, huge_kb);
+            if (hits < queries) {
+                printf("Warning: index missed queries taken from the text\n");
+            }
+            kmp_index_destroy(index);
+        }
+        kmp_free(text);
+    }
+
+    kmp_huge_pages_enable(false);
+    if (dtlb >= 0) close(dtlb);
+}
+
 void memory_usage_analysis() {
     printf("\n=== Memory Usage Analysis ===\n");
 
     int pattern_sizes[] = {10, 100, 1000, 10000};
     int num_sizes = sizeof(pattern_sizes) / sizeof(pattern_sizes[0]);
 
-    printf("%-15s %-20s %-15s\n", "Pattern Size", "Memory Usage (bytes)", "Per Character");
-    printf("---------------------------------------------------\n");
+    printf("%-15s %-20s %-15s %-20s\n", "Pattern Size", "Memory Usage (bytes)",
+           "Per Character", "Search Peak (bytes)");
+    printf("------------------------------------------------------------------------\n");
 
     for (int i = 0; i < num_sizes; i++) {
         char* pattern = generate_random_string(pattern_sizes[i], 4);
         if (!pattern) continue;
 
         KMPMatcher* matcher = kmp_create(pattern);
-        if (matcher) {
+        char* text = generate_periodic_string(pattern_sizes[i] * 1000, pattern);
+        if (matcher && text) {
+            int count;
+            kmp_free(kmp_search_all(matcher, text, &count));
+            KMPMemoryCounter memory;
+            kmp_matcher_memory(matcher, &memory);
+
             double per_char = (double)matcher->memory_usage / pattern_sizes[i];
-            printf("%-15d %-20zu %-15.2f\n",
-                   pattern_sizes[i], matcher->memory_usage, per_char);
-            kmp_destroy(matcher);
+            printf("%-15d %-20zu %-15.2f %-20zu\n", pattern_sizes[i], matcher->memory_usage,
+                   per_char, sizeof(KMPMatcher) + memory.peak_bytes);
         }
+        kmp_destroy(matcher);
+        free(text);
 
         free(pattern);
     }
@@ -282,6 +1224,18 @@ int main() {
     benchmark_varying_pattern_size();
     benchmark_worst_case();
     benchmark_alphabet_size();
+    benchmark_lps_construction();
+    benchmark_engine_matrix();
+    benchmark_index_vs_scan();
+    benchmark_stream_replace();
+#ifdef KMP_HAVE_ZLIB
+    benchmark_compressed_search();
+#endif
+    benchmark_packed_dna();
+    benchmark_multi_pattern();
+    benchmark_compressed_positions();
+    benchmark_numa_parallel();
+    benchmark_huge_pages();
     memory_usage_analysis();
 
     printf("\nBenchmark completed.\n");
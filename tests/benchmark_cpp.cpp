@@ -0,0 +1,126 @@
+#include "../include/kmp.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using kmp_clock = std::chrono::steady_clock;
+
+static double elapsed_ms(kmp_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(kmp_clock::now() - start).count();
+}
+
+static std::string generate_text(std::size_t length) {
+    std::mt19937 rng(12345);
+    std::string text(length, ' ');
+    for (char& c : text) {
+        c = 'a' + rng() % 4;
+    }
+    return text;
+}
+
+template <kmp::fixed_string Pattern>
+static void benchmark_literal(const std::string& text, int iterations) {
+    using literal = kmp::matcher<Pattern>;
+    const char* pattern = literal::pattern.data;
+    long long c_count = 0;
+    long long cached_count = 0;
+    long long literal_count = 0;
+    long long dynamic_count = 0;
+
+    auto start = kmp_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        KMPMatcher* matcher = kmp_create(pattern);
+        int count;
+        kmp_free(kmp_search_all(matcher, text.c_str(), &count));
+        kmp_destroy(matcher);
+        c_count += count;
+    }
+    double c_time = elapsed_ms(start) / iterations;
+
+    KMPMatcher* cached = kmp_create(pattern);
+    start = kmp_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        int count;
+        kmp_free(kmp_search_all(cached, text.c_str(), &count));
+        cached_count += count;
+    }
+    double cached_time = elapsed_ms(start) / iterations;
+    kmp_destroy(cached);
+
+    start = kmp_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        literal_count += std::ranges::distance(literal::find_all(text));
+    }
+    double literal_time = elapsed_ms(start) / iterations;
+
+    kmp::dynamic_matcher dynamic(pattern);
+    start = kmp_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        dynamic_count += std::ranges::distance(dynamic.find_all(text));
+    }
+    double dynamic_time = elapsed_ms(start) / iterations;
+
+    bool agree = c_count == cached_count && c_count == literal_count && c_count == dynamic_count;
+    std::printf("%-12s %-14.3f %-14.3f %-14.3f %-14.3f %s\n", pattern, c_time, cached_time,
+                literal_time, dynamic_time, agree ? "yes" : "NO");
+}
+
+static void benchmark_small_texts() {
+    std::vector<std::string> lines;
+    std::mt19937 rng(7);
+    for (int i = 0; i < 100000; i++) {
+        std::string line(24 + rng() % 40, 'x');
+        for (char& c : line) {
+            c = 'a' + rng() % 26;
+        }
+        if (i % 10 == 0) {
+            line.replace(line.size() / 2, 5, "error");
+        }
+        lines.push_back(line);
+    }
+
+    auto start = kmp_clock::now();
+    long long c_hits = 0;
+    for (const std::string& line : lines) {
+        KMPMatcher* matcher = kmp_create("error");
+        c_hits += kmp_search(matcher, line.c_str()) >= 0;
+        kmp_destroy(matcher);
+    }
+    double c_time = elapsed_ms(start);
+
+    start = kmp_clock::now();
+    long long literal_hits = std::ranges::count_if(lines, [](const std::string& line) {
+        return kmp::matcher<"error">::find(line).has_value();
+    });
+    double literal_time = elapsed_ms(start);
+
+    std::printf("\n100000 short lines, pattern \"error\" (%lld/%lld hits)\n", c_hits, literal_hits);
+    std::printf("C API create+search+destroy: %.3f ms\n", c_time);
+    std::printf("kmp::matcher<\"error\">::find:  %.3f ms (%.1fx)\n", literal_time,
+                literal_time > 0 ? c_time / literal_time : 0.0);
+}
+
+int main() {
+    std::printf("KMP C++ Wrapper Benchmark\n");
+    std::printf("=========================\n");
+
+    std::string text = generate_text(1000000);
+    std::printf("Text size: %zu (times in ms per full scan)\n", text.size());
+    std::printf("%-12s %-14s %-14s %-14s %-14s %s\n", "Pattern", "C create+all", "C cached",
+                "matcher<>", "dynamic", "Agree");
+    std::printf("--------------------------------------------------------------------------------\n");
+
+    benchmark_literal<"ab">(text, 20);
+    benchmark_literal<"abcd">(text, 20);
+    benchmark_literal<"dcbaabcd">(text, 20);
+    benchmark_literal<"abababab">(text, 20);
+
+    benchmark_small_texts();
+
+    std::printf("\nBenchmark completed.\n");
+    return 0;
+}
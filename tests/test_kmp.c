@@ -1,5 +1,14 @@
+#define _POSIX_C_SOURCE 200809L
 #include "../include/kmp.h"
 #include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#ifdef KMP_HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 typedef struct {
     char* pattern;
@@ -55,7 +64,7 @@ void test_lps_computation() {
                     break;
                 }
             }
-            free(lps);
+            kmp_free(lps);
         } else {
             passed = false;
         }
@@ -66,6 +75,32 @@ void test_lps_computation() {
     }
 }
 
+void test_failure_tables() {
+    printf("\n=== Testing Failure Tables ===\n");
+
+    int lps[7];
+    int strong[7];
+    int expected_lps[] = {0, 0, 1, 2, 0, 1, 2};
+    int expected_strong[] = {0, 0, 0, 2, 0, 0, 2};
+
+    KMPError error = kmp_build_failure_tables("ABABCAB", 7, lps, strong);
+    run_test("Failure tables built into caller buffers", error == KMP_SUCCESS &&
+             memcmp(lps, expected_lps, sizeof(lps)) == 0);
+    run_test("Strong failure function", memcmp(strong, expected_strong, sizeof(strong)) == 0);
+
+    int periodic_lps[6];
+    int periodic_strong[6];
+    kmp_build_failure_tables("AAAAAB", 6, periodic_lps, periodic_strong);
+    run_test("Strong table skips equal fallbacks",
+             periodic_strong[0] == 0 && periodic_strong[3] == 0 &&
+             periodic_strong[4] == 4 && periodic_lps[4] == 4);
+
+    run_test("Failure tables reject NULL buffer",
+             kmp_build_failure_tables("AB", 2, NULL, NULL) == KMP_ERROR_NULL_POINTER);
+    run_test("Failure tables reject empty pattern",
+             kmp_build_failure_tables("", 0, lps, NULL) == KMP_ERROR_EMPTY_PATTERN);
+}
+
 void test_basic_search() {
     printf("\n=== Testing Basic Search ===\n");
 
@@ -132,7 +167,7 @@ void test_multiple_search() {
             }
 
             if (positions) {
-                free(positions);
+                kmp_free(positions);
             }
             kmp_destroy(matcher);
         }
@@ -192,6 +227,81 @@ void test_memory_management() {
     run_test("Destroy NULL matcher (no crash)", true);
 }
 
+typedef struct {
+    size_t allocations;
+    size_t frees;
+} CountingHeap;
+
+static void* counting_malloc(size_t size, void* context) {
+    ((CountingHeap*)context)->allocations++;
+    return malloc(size);
+}
+
+static void* counting_realloc(void* ptr, size_t size, void* context) {
+    (void)context;
+    return realloc(ptr, size);
+}
+
+static void counting_free(void* ptr, void* context) {
+    ((CountingHeap*)context)->frees++;
+    free(ptr);
+}
+
+void test_allocator_hooks() {
+    printf("\n=== Testing Allocator Hooks ===\n");
+
+    KMPAllocator broken = {counting_malloc, NULL, counting_free, NULL};
+    run_test("Incomplete allocator rejected",
+             kmp_set_allocator(&broken) == KMP_ERROR_INVALID_INPUT);
+    run_test("Overflowing calloc fails", kmp_calloc(SIZE_MAX / 2, 4) == NULL);
+
+    CountingHeap heap = {0, 0};
+    KMPAllocator counting = {counting_malloc, counting_realloc, counting_free, &heap};
+    KMPMemoryCounter before, after;
+    kmp_memory_stats(&before);
+    run_test("Allocator installed", kmp_set_allocator(&counting) == KMP_SUCCESS);
+
+    KMPMatcher* matcher = kmp_create("ab");
+    run_test("Matcher allocated through hook", matcher && heap.allocations >= 3);
+    if (!matcher) {
+        kmp_set_allocator(NULL);
+        return;
+    }
+
+    KMPMemoryCounter tables;
+    kmp_matcher_memory(matcher, &tables);
+    run_test("Matcher counter holds pattern and LPS",
+             tables.live_bytes == 3 + 2 * sizeof(int) &&
+             matcher->memory_usage == sizeof(KMPMatcher) + tables.live_bytes);
+
+    char text[2001];
+    for (int i = 0; i < 2000; i++) {
+        text[i] = "ab"[i % 2];
+    }
+    text[2000] = '\0';
+    int count;
+    int* positions = kmp_search_all(matcher, text, &count);
+
+    KMPMemoryCounter searched;
+    kmp_matcher_memory(matcher, &searched);
+    kmp_memory_stats(&after);
+    run_test("Search buffers counted in matcher peak",
+             count == 1000 && searched.live_bytes == tables.live_bytes &&
+             searched.peak_bytes >= tables.live_bytes + 1000 * sizeof(int));
+    run_test("Returned result counted globally",
+             after.live_bytes >= before.live_bytes + 1000 * sizeof(int) &&
+             after.peak_bytes >= after.live_bytes);
+
+    /* Blocks go back to the allocator that produced them. */
+    kmp_set_allocator(NULL);
+    size_t frees = heap.frees;
+    kmp_free(positions);
+    kmp_destroy(matcher);
+    kmp_memory_stats(&after);
+    run_test("Frees return to original allocator", heap.frees == frees + 4);
+    run_test("Global live bytes restored", after.live_bytes == before.live_bytes);
+}
+
 void test_ascii_validation() {
     printf("\n=== Testing ASCII Validation ===\n");
 
@@ -216,7 +326,7 @@ void test_utility_functions() {
     char* copy = safe_string_copy("TEST");
     bool copy_ok = (copy != NULL && strcmp(copy, "TEST") == 0);
     run_test("Safe string copy", copy_ok);
-    if (copy) free(copy);
+    free(copy);
 
     run_test("Safe copy of NULL", safe_string_copy(NULL) == NULL);
 
@@ -226,6 +336,1070 @@ void test_utility_functions() {
     run_test("Time measurement (approximately 1ms)", time_ms >= 0.5 && time_ms <= 2.0);
 }
 
+typedef struct {
+    KMPMatcherSlot* slot;
+    const char* text;
+    int iterations;
+    int failures;
+} SharedSearchJob;
+
+static void* shared_search_worker(void* arg) {
+    SharedSearchJob* job = (SharedSearchJob*)arg;
+
+    for (int i = 0; i < job->iterations; i++) {
+        KMPMatcher* matcher = kmp_slot_acquire(job->slot);
+        int count;
+        int* positions = kmp_search_all(matcher, job->text, &count);
+        if (count != 3 || !positions || positions[0] != 1) {
+            job->failures++;
+        }
+        kmp_free(positions);
+        kmp_release(matcher);
+    }
+
+    return NULL;
+}
+
+static void* shared_publish_worker(void* arg) {
+    KMPMatcherSlot* slot = (KMPMatcherSlot*)arg;
+    for (int i = 0; i < 200; i++) {
+        KMPMatcher* replacement = kmp_create("ABA");
+        kmp_slot_publish(slot, replacement);
+        kmp_destroy(replacement);
+        if (i % 16 == 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void count_chunk_match(size_t position, void* user_data) {
+    size_t* last = (size_t*)user_data;
+    last[0]++;
+    last[1] = position;
+}
+
+void test_shared_matcher() {
+    printf("\n=== Testing Shared Matcher ===\n");
+
+    KMPMatcher* matcher = kmp_create("ABA");
+    run_test("Shared matcher refcount starts at 1", matcher && matcher->refcount == 1);
+    if (!matcher) {
+        return;
+    }
+
+    run_test("Retain returns same matcher", kmp_retain(matcher) == matcher);
+    kmp_release(matcher);
+    run_test("Release keeps matcher alive", matcher->refcount == 1);
+
+    const char* text = "XABAXABABA";
+    KMPSearchState state;
+    kmp_search_state_init(&state);
+    size_t seen[2] = {0, 0};
+    int found = 0;
+    for (size_t i = 0; i < strlen(text); i++) {
+        found += kmp_search_chunk(matcher, &state, text + i, 1, count_chunk_match, seen);
+    }
+    run_test("Chunked search across byte boundaries", found == 3 && seen[0] == 3 && seen[1] == 7);
+
+    KMPMatcherSlot slot;
+    kmp_slot_init(&slot, matcher);
+    kmp_destroy(matcher);
+
+    pthread_t threads[4];
+    SharedSearchJob jobs[4];
+    for (int i = 0; i < 4; i++) {
+        jobs[i].slot = &slot;
+        jobs[i].text = text;
+        jobs[i].iterations = 2000;
+        jobs[i].failures = 0;
+        pthread_create(&threads[i], NULL, shared_search_worker, &jobs[i]);
+    }
+
+    for (int i = 0; i < 50; i++) {
+        KMPMatcher* replacement = kmp_create("ABA");
+        kmp_slot_publish(&slot, replacement);
+        kmp_destroy(replacement);
+    }
+
+    int failures = 0;
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+        failures += jobs[i].failures;
+    }
+    run_test("Concurrent searches during hot swap", failures == 0);
+
+    /* Several publishers racing readers exercise back-to-back epoch flips;
+     * run under ASan/TSan (make sanitize) to catch a reader retaining a
+     * matcher that a second flip already released. */
+    pthread_t readers[6];
+    pthread_t publishers[3];
+    SharedSearchJob stress[6];
+    for (int i = 0; i < 6; i++) {
+        stress[i].slot = &slot;
+        stress[i].text = text;
+        stress[i].iterations = 3000;
+        stress[i].failures = 0;
+        pthread_create(&readers[i], NULL, shared_search_worker, &stress[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        pthread_create(&publishers[i], NULL, shared_publish_worker, &slot);
+    }
+    for (int i = 0; i < 3; i++) {
+        pthread_join(publishers[i], NULL);
+    }
+    failures = 0;
+    for (int i = 0; i < 6; i++) {
+        pthread_join(readers[i], NULL);
+        failures += stress[i].failures;
+    }
+    run_test("Concurrent publishers and readers", failures == 0);
+
+    kmp_slot_destroy(&slot);
+}
+
+static void* deferred_search_worker(void* arg) {
+    KMPMatcher* matcher = (KMPMatcher*)arg;
+    return (void*)(size_t)(kmp_search(matcher, "XXDEFERRED") == 2);
+}
+
+static void record_stream_match(size_t position, void* user_data) {
+    size_t* positions = (size_t*)user_data;
+    positions[++positions[0]] = position;
+}
+
+static bool same_positions(const int* a, int a_count, const int* b, int b_count) {
+    if (a_count != b_count) {
+        return false;
+    }
+    return a_count == 0 || memcmp(a, b, a_count * sizeof(int)) == 0;
+}
+
+void test_engine_planner() {
+    printf("\n=== Testing Engine Planner ===\n");
+
+    struct {
+        const char* pattern;
+        const char* text;
+    } cases[] = {
+        {"AA", "AAAAABAAAA"},
+        {"ABAB", "ABABABXABABAB"},
+        {"needle", "haystack with a needle and another needle"},
+        {"Z", "ZAZZZ"},
+        {"The quick brown fox jumps", "...The quick brown fox jumps over. The quick brown fox jumps"},
+        {"XYZ", "ABCDEF"}
+    };
+    int num_cases = sizeof(cases) / sizeof(cases[0]);
+    KMPEngine engines[] = {KMP_ENGINE_DFA, KMP_ENGINE_HORSPOOL, KMP_ENGINE_MEMMEM,
+                           KMP_ENGINE_STRONG, KMP_ENGINE_AUTO};
+
+    for (int e = 0; e < 5; e++) {
+        bool passed = true;
+        for (int i = 0; i < num_cases; i++) {
+            KMPMatcher* reference = kmp_create(cases[i].pattern);
+            KMPOptions options = {0, engines[e], NULL, 0};
+            KMPMatcher* matcher = kmp_create_ex(cases[i].pattern, &options);
+            if (!reference || !matcher) {
+                passed = false;
+            } else {
+                int expected_count, count;
+                int* expected = kmp_search_all(reference, cases[i].text, &expected_count);
+                int* positions = kmp_search_all(matcher, cases[i].text, &count);
+                passed = passed && same_positions(expected, expected_count, positions, count) &&
+                         kmp_search(matcher, cases[i].text) == kmp_search(reference, cases[i].text);
+                kmp_free(expected);
+                kmp_free(positions);
+            }
+            kmp_destroy(reference);
+            kmp_destroy(matcher);
+        }
+
+        char test_name[100];
+        sprintf(test_name, "%s engine matches LPS results", kmp_engine_name(engines[e]));
+        run_test(test_name, passed);
+    }
+
+    KMPOptions automatic = {0, KMP_ENGINE_AUTO, NULL, 0};
+    KMPMatcher* matcher = kmp_create_ex("ABABABAB", &automatic);
+    run_test("Planner keeps automaton for periodic pattern",
+             matcher && matcher->engine == KMP_ENGINE_LPS && matcher->period == 2);
+    kmp_destroy(matcher);
+
+    matcher = kmp_create_ex("Z", &automatic);
+    run_test("Planner uses memmem for single byte", matcher && matcher->engine == KMP_ENGINE_MEMMEM);
+    kmp_destroy(matcher);
+
+    matcher = kmp_create_ex("The quick brown fox jumps", &automatic);
+    run_test("Planner uses memmem on aperiodic pattern",
+             matcher && matcher->engine == KMP_ENGINE_MEMMEM);
+    kmp_destroy(matcher);
+
+    KMPOptions forced = {0, KMP_ENGINE_HORSPOOL, NULL, 0};
+    matcher = kmp_create_ex("The quick brown fox jumps", &forced);
+    run_test("Forced engine overrides planner", matcher &&
+             matcher->engine == KMP_ENGINE_HORSPOOL && matcher->shift &&
+             matcher->shift['q'] == 20 && kmp_search(matcher, cases[4].text) == 3);
+    kmp_destroy(matcher);
+
+    const char* sample = "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAB";
+    KMPOptions binary = {0, KMP_ENGINE_AUTO, sample, strlen(sample)};
+    matcher = kmp_create_ex("AAAAB", &binary);
+    run_test("Planner uses text sample", matcher && matcher->text_alphabet == 2 &&
+             matcher->engine == KMP_ENGINE_DFA);
+    kmp_destroy(matcher);
+
+    matcher = kmp_create_ex("ACGTTGCAACGG", &binary);
+    run_test("Planner sends high-entropy pattern to memmem", matcher &&
+             matcher->entropy > 1.0 && matcher->engine == KMP_ENGINE_MEMMEM);
+    kmp_destroy(matcher);
+}
+
+void test_strong_engine() {
+    printf("\n=== Testing Strong-KMP Engine ===\n");
+
+    KMPOptions lps_options = {0, KMP_ENGINE_LPS, NULL, 0};
+    KMPOptions strong_options = {0, KMP_ENGINE_STRONG, NULL, 0};
+    KMPMatcher* lps = kmp_create_ex("AAAAAAB", &lps_options);
+    KMPMatcher* strong = kmp_create_ex("AAAAAAB", &strong_options);
+    run_test("Strong-KMP engine builds strong table", strong && strong->strong &&
+             strong->strong[5] == 5 && strong->strong[4] == 0 && strong->strong[6] == 0);
+
+    const char* text = "AAAAAACAAAAAACAAAAAABAAAAAAAB";
+    int n = strlen(text);
+    unsigned long long lps_comparisons = kmp_count_comparisons(lps, text, n);
+    unsigned long long strong_comparisons = kmp_count_comparisons(strong, text, n);
+    run_test("Strong failure saves comparisons", strong_comparisons < lps_comparisons);
+    run_test("Comparisons stay within 2n", lps_comparisons <= 2ULL * n &&
+             strong_comparisons <= 2ULL * n);
+
+    int count;
+    int* positions = kmp_search_all(strong, text, &count);
+    run_test("Strong-KMP engine finds matches", count == 2 && positions &&
+             positions[0] == 14 && positions[1] == 22);
+    kmp_free(positions);
+    kmp_destroy(lps);
+    kmp_destroy(strong);
+
+    strong = kmp_create_ex("ABAB", &strong_options);
+    positions = kmp_search_all(strong, "ABABABAB", &count);
+    run_test("Strong-KMP engine finds overlapping matches", count == 3 && positions &&
+             positions[2] == 4 && strong->period == 2);
+    kmp_free(positions);
+    run_test("Period shift skips the known prefix",
+             kmp_count_comparisons(strong, "ABABABAB", 8) == 8);
+    kmp_destroy(strong);
+
+    const char* periodic_text = "ABAABAABABAABAABAABAAB";
+    strong = kmp_create_ex("ABAABAAB", &strong_options);
+    lps = kmp_create_ex("ABAABAAB", &lps_options);
+    int lps_count;
+    int* lps_positions = kmp_search_all(lps, periodic_text, &lps_count);
+    positions = kmp_search_all(strong, periodic_text, &count);
+    run_test("Strong-KMP engine agrees with LPS-KMP", strong->period == 3 && count == lps_count &&
+             count == 4 && positions && lps_positions &&
+             memcmp(positions, lps_positions, count * sizeof(int)) == 0);
+    kmp_free(positions);
+    kmp_free(lps_positions);
+    kmp_destroy(lps);
+    kmp_destroy(strong);
+}
+
+void test_range_search() {
+    printf("\n=== Testing Range Search ===\n");
+
+    KMPMatcher* matcher = kmp_create("abc");
+    const char buffer[] = {'a', 'b', 'c', 'X', 'a', 'b', 'c', 'X', 'a', 'b', 'c'};
+    KMPSearchOptions options = {1, 11, NULL, 0};
+    KMPSearchState cursor;
+    size_t* positions;
+    size_t count;
+
+    kmp_search_state_init(&cursor);
+    KMPError error = kmp_search_range(matcher, buffer, sizeof(buffer), &options, &cursor,
+                                      &positions, &count);
+    run_test("Range search skips matches before start", error == KMP_SUCCESS &&
+             count == 2 && positions[0] == 4 && positions[1] == 8 && cursor.offset == 11);
+    kmp_free(positions);
+
+    options.end = 10;
+    kmp_search_state_init(&cursor);
+    kmp_search_range(matcher, buffer, sizeof(buffer), &options, &cursor, &positions, &count);
+    run_test("Range search stops at end", count == 1 && positions[0] == 4);
+    kmp_free(positions);
+
+    KMPCancelToken token;
+    kmp_cancel_token_init(&token);
+    kmp_cancel(&token);
+    KMPSearchOptions cancelled = {0, 0, &token, 0};
+    kmp_search_state_init(&cursor);
+    error = kmp_search_range(matcher, buffer, sizeof(buffer), &cancelled, &cursor,
+                             &positions, &count);
+    run_test("Cancelled search returns cursor", error == KMP_ERROR_CANCELLED &&
+             count == 0 && cursor.offset == 0);
+
+    kmp_cancel_token_init(&token);
+    error = kmp_search_range(matcher, buffer, sizeof(buffer), &cancelled, &cursor,
+                             &positions, &count);
+    run_test("Cancelled search resumes", error == KMP_SUCCESS && count == 3);
+    kmp_free(positions);
+
+    KMPSearchOptions expired = {0, 0, NULL, 1};
+    kmp_search_state_init(&cursor);
+    error = kmp_search_range(matcher, buffer, sizeof(buffer), &expired, &cursor,
+                             &positions, &count);
+    run_test("Expired deadline stops search", error == KMP_ERROR_DEADLINE_EXCEEDED &&
+             count == 0 && strcmp(kmp_error_string(error), "Search deadline exceeded") == 0);
+    kmp_destroy(matcher);
+
+    size_t len = 3 * KMP_SEARCH_POLL_BYTES;
+    char* text = (char*)malloc(len);
+    memset(text, 'x', len);
+    memcpy(text + KMP_SEARCH_POLL_BYTES - 2, "needle", 6);
+    memcpy(text + 2 * KMP_SEARCH_POLL_BYTES + 7, "needle", 6);
+    matcher = kmp_create("needle");
+
+    KMPSearchOptions head = {0, KMP_SEARCH_POLL_BYTES, NULL, 0};
+    kmp_search_state_init(&cursor);
+    kmp_search_range(matcher, text, len, &head, &cursor, &positions, &count);
+    bool partial = count == 0 && cursor.matched == 2;
+    KMPSearchOptions rest = {0, 0, NULL, 0};
+    kmp_search_range(matcher, text, len, &rest, &cursor, &positions, &count);
+    run_test("Cursor carries partial match across calls", partial && count == 2 &&
+             positions[0] == KMP_SEARCH_POLL_BYTES - 2 &&
+             positions[1] == 2 * KMP_SEARCH_POLL_BYTES + 7);
+    kmp_free(positions);
+
+    kmp_destroy(matcher);
+    free(text);
+}
+
+void test_parallel_search() {
+    printf("\n=== Testing NUMA Parallel Search ===\n");
+
+    KMPTopology topology;
+    KMPError error = kmp_topology_detect(&topology);
+    run_test("Topology has at least one node with CPUs", error == KMP_SUCCESS &&
+             topology.node_count >= 1 && topology.node_cpu_count[0] >= 1);
+    kmp_topology_free(&topology);
+
+    int len = 100003;
+    char* source = (char*)malloc(len + 1);
+    for (int i = 0; i < len; i++) {
+        source[i] = "ab"[(i * 7 + i / 3) % 5 == 0];
+    }
+    source[len] = '\0';
+
+    KMPNumaText* text = kmp_numa_text_create(source, len);
+    run_test("NUMA text copies the source", text && text->len == (size_t)len &&
+             memcmp(text->data, source, len) == 0 &&
+             text->node_offsets[text->topology.node_count] == (size_t)len);
+
+    KMPMatcher* matcher = kmp_create("aaba");
+    int expected_count;
+    int* expected = kmp_search_all(matcher, source, &expected_count);
+
+    int thread_counts[] = {1, 3, 7};
+    bool agrees = text != NULL && expected_count > 0;
+    size_t scanned = 0;
+    for (int t = 0; agrees && t < 3; t++) {
+        KMPParallelStats stats;
+        size_t count;
+        size_t* positions = kmp_parallel_search_all(matcher, text, thread_counts[t], &count, &stats);
+        agrees = count == (size_t)expected_count;
+        for (size_t i = 0; agrees && i < count; i++) {
+            agrees = positions[i] == (size_t)expected[i];
+        }
+        scanned = 0;
+        for (int n = 0; n < stats.node_count; n++) {
+            scanned += stats.node_bytes[n];
+        }
+        kmp_free(positions);
+    }
+    run_test("Parallel search agrees with KMP", agrees);
+    run_test("Parallel stats cover the whole text", scanned == (size_t)len);
+
+    kmp_free(expected);
+    kmp_destroy(matcher);
+    kmp_numa_text_destroy(text);
+    free(source);
+}
+
+void test_huge_pages() {
+    printf("\n=== Testing Huge Page Option ===\n");
+
+    run_test("Huge pages off by default", !kmp_huge_pages_enabled());
+    kmp_huge_pages_enable(true);
+
+    size_t len = 3 * KMP_HUGE_PAGE_SIZE + 12345;
+    char* source = (char*)kmp_malloc(len + 1);
+    run_test("Large allocation with huge pages", source != NULL);
+    if (!source) {
+        kmp_huge_pages_enable(false);
+        return;
+    }
+    for (size_t i = 0; i < len; i++) {
+        source[i] = "xy"[i % 7 == 0];
+    }
+    memcpy(source + len - 5, "yxxxy", 5);
+    source[len] = '\0';
+
+    KMPNumaText* text = kmp_numa_text_create(source, len);
+    run_test("NUMA text falls back or uses 2MB pages",
+             text && (text->page_size == KMP_HUGE_PAGE_SIZE ||
+                      text->page_size == (size_t)sysconf(_SC_PAGESIZE)) &&
+             text->mapping_len % text->page_size == 0 && memcmp(text->data, source, len) == 0);
+
+    KMPMatcher* matcher = kmp_create("yxxxy");
+    int expected_count;
+    int* expected = kmp_search_all(matcher, source, &expected_count);
+    size_t count = 0;
+    size_t* positions = text ? kmp_parallel_search_all(matcher, text, 2, &count, NULL) : NULL;
+    run_test("Search over huge-page text", expected_count > 0 &&
+             count == (size_t)expected_count &&
+             positions[count - 1] == (size_t)expected[expected_count - 1]);
+
+    kmp_free(positions);
+    kmp_free(expected);
+    kmp_destroy(matcher);
+    kmp_numa_text_destroy(text);
+    kmp_free(source);
+    kmp_huge_pages_enable(false);
+}
+
+void test_multi_pattern() {
+    printf("\n=== Testing Multi-Pattern Engine ===\n");
+
+    const char* patterns[] = {"he", "she", "his", "hers", "ushers",
+                              "a pattern longer than sixteen bytes", "x"};
+    int num_patterns = sizeof(patterns) / sizeof(patterns[0]);
+    const char* text = "ushers said his hers; she kept a pattern longer than sixteen bytes"
+                       " and a pattern longer than sixteen byte";
+    size_t len = strlen(text);
+
+    KMPMultiMatcher* multi = kmp_multi_create(patterns, num_patterns);
+    run_test("Multi matcher creation", multi != NULL && multi->lane_count % 4 == 0);
+
+    size_t expected_total = 0;
+    for (int p = 0; p < num_patterns; p++) {
+        KMPMatcher* matcher = kmp_create(patterns[p]);
+        int count;
+        kmp_free(kmp_search_all(matcher, text, &count));
+        expected_total += count;
+        kmp_destroy(matcher);
+    }
+
+    bool modes_agree = multi != NULL;
+    for (int mode = 0; multi && mode < 2; mode++) {
+        multi->use_simd = mode == 0 && kmp_multi_simd_available();
+        size_t count;
+        KMPMultiMatch* matches = kmp_multi_search_all(multi, text, len, &count);
+        bool ordered = true;
+        bool exact = true;
+        for (size_t i = 0; i < count; i++) {
+            int p = matches[i].pattern;
+            exact = exact && strncmp(text + matches[i].position, patterns[p], strlen(patterns[p])) == 0;
+            if (i > 0) {
+                ordered = ordered && matches[i - 1].position <= matches[i].position;
+            }
+        }
+        modes_agree = modes_agree && count == expected_total && ordered && exact;
+        kmp_free(matches);
+    }
+    run_test("Multi matcher finds every pattern occurrence", modes_agree);
+
+    const char* many[64];
+    char storage[64][8];
+    for (int p = 0; p < 64; p++) {
+        sprintf(storage[p], "key%02dz", p);
+        many[p] = storage[p];
+    }
+    KMPMultiMatcher* wide = kmp_multi_create(many, 64);
+    size_t count;
+    KMPMultiMatch* matches = kmp_multi_search_all(wide, "..key07z..key63z.key00zkey64z", 29, &count);
+    run_test("Multi matcher spans several lane groups", wide && wide->lane_count == 8 &&
+             count == 3 && matches[0].pattern == 7 && matches[1].pattern == 63 &&
+             matches[2].pattern == 0 && matches[2].position == 17);
+    kmp_free(matches);
+
+    const char* empty[] = {"ok", ""};
+    run_test("Multi matcher rejects empty pattern", kmp_multi_create(empty, 2) == NULL);
+
+    kmp_multi_destroy(wide);
+    kmp_multi_destroy(multi);
+}
+
+void test_compressed_positions() {
+    printf("\n=== Testing Compressed Positions ===\n");
+
+    int len = 5000;
+    char* text = (char*)malloc(len + 1);
+    for (int i = 0; i < len; i++) {
+        text[i] = (i % 3 == 0 || i % 997 == 1) ? 'a' : 'b';
+    }
+    text[len] = '\0';
+
+    KMPMatcher* matcher = kmp_create("ab");
+    int expected_count;
+    int* expected = kmp_search_all(matcher, text, &expected_count);
+    KMPPositionList* list = kmp_search_all_compressed(matcher, text);
+    run_test("Compressed search counts every match", list && list->count == (size_t)expected_count &&
+             list->block_count == (list->count + KMP_POSITIONS_BLOCK - 1) / KMP_POSITIONS_BLOCK);
+
+    KMPPositionIter iter;
+    size_t position;
+    size_t index = 0;
+    bool agrees = list != NULL;
+    kmp_positions_iter_init(&iter, list);
+    while (agrees && kmp_positions_next(&iter, &position)) {
+        agrees = position == (size_t)expected[index++];
+    }
+    run_test("Iterator decodes positions in order", agrees && index == (size_t)expected_count);
+
+    size_t block[KMP_POSITIONS_BLOCK];
+    size_t decoded = list ? kmp_positions_decode_block(list, 3, block) : 0;
+    size_t last;
+    run_test("Block and index random access", decoded == KMP_POSITIONS_BLOCK &&
+             block[5] == (size_t)expected[3 * KMP_POSITIONS_BLOCK + 5] &&
+             kmp_positions_get(list, expected_count - 1, &last) == KMP_SUCCESS &&
+             last == (size_t)expected[expected_count - 1]);
+    run_test("Compressed list is smaller than int array",
+             list && list->data_len + list->block_count * 2 * sizeof(size_t) <
+                 expected_count * sizeof(int));
+
+    size_t size;
+    unsigned char* buffer = kmp_positions_serialize(list, &size);
+    KMPPositionList* copy = kmp_positions_deserialize(buffer, size);
+    run_test("Serialization round trip", copy && copy->count == list->count &&
+             kmp_positions_get(copy, 200, &position) == KMP_SUCCESS &&
+             position == (size_t)expected[200]);
+    KMPPositionList* truncated = buffer ? kmp_positions_deserialize(buffer, size - 1) : NULL;
+    run_test("Truncated buffer is rejected", truncated == NULL);
+
+    unsigned char header[32] = "KMPPOS01";
+    memset(header + 8, 0xff, 8);
+    KMPPositionList* huge = kmp_positions_deserialize(header, sizeof(header));
+    run_test("Huge count with no blocks is rejected", huge == NULL);
+    KMPPositionList* mismatched = NULL;
+    if (buffer) {
+        buffer[16]++;
+        mismatched = kmp_positions_deserialize(buffer, size);
+        buffer[16]--;
+    }
+    run_test("Block count not matching count is rejected", mismatched == NULL);
+
+    KMPPositionList* manual = kmp_positions_create();
+    kmp_positions_append(manual, (size_t)1 << 40);
+    run_test("Positions must not decrease", kmp_positions_append(manual, 7) == KMP_ERROR_INVALID_INPUT &&
+             kmp_positions_get(manual, 0, &position) == KMP_SUCCESS && position == (size_t)1 << 40);
+
+    kmp_positions_destroy(manual);
+    kmp_positions_destroy(copy);
+    kmp_free(buffer);
+    kmp_positions_destroy(list);
+    kmp_free(expected);
+    kmp_destroy(matcher);
+    free(text);
+}
+
+static long long search_file(const char* path, const char* pattern, KMPCompression format,
+                             size_t* positions) {
+    FILE* in = fopen(path, "rb");
+    if (!in) {
+        return -1;
+    }
+    KMPMatcher* matcher = kmp_create(pattern);
+    long long found = kmp_search_compressed(matcher, fileno(in), format,
+                                            record_stream_match, positions);
+    kmp_destroy(matcher);
+    fclose(in);
+    return found;
+}
+
+void test_compressed_search() {
+    printf("\n=== Testing Compressed Search ===\n");
+
+    /* Two halves with a match straddling the first ring slot boundary. */
+    size_t half = KMP_RING_BUFFER_SIZE + 1000;
+    char* text = (char*)malloc(2 * half);
+    if (!text) {
+        return;
+    }
+    memset(text, '.', 2 * half);
+    memcpy(text + 5, "needle", 6);
+    memcpy(text + KMP_RING_BUFFER_SIZE - 3, "needle", 6);
+    memcpy(text + half - 3, "needle", 6);
+    memcpy(text + 2 * half - 6, "needle", 6);
+    size_t expected[] = {5, KMP_RING_BUFFER_SIZE - 3, half - 3, 2 * half - 6};
+
+    char path[] = "/tmp/kmp_compressed_test_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        free(text);
+        return;
+    }
+    bool written = write(fd, text, 2 * half) == (ssize_t)(2 * half);
+    close(fd);
+
+    size_t positions[16] = {0};
+    run_test("Plain input passes through",
+             written && search_file(path, "needle", KMP_COMPRESSION_AUTO, positions) == 4 &&
+             memcmp(positions + 1, expected, sizeof(expected)) == 0);
+
+#ifdef KMP_HAVE_ZLIB
+    /* Appending opens a new gzip member, as `cat a.gz b.gz` would. */
+    gzFile first = gzopen(path, "wb");
+    gzFile second = NULL;
+    written = first && gzwrite(first, text, half) == (int)half && gzclose(first) == Z_OK &&
+              (second = gzopen(path, "ab")) != NULL &&
+              gzwrite(second, text + half, half) == (int)half && gzclose(second) == Z_OK;
+
+    memset(positions, 0, sizeof(positions));
+    run_test("Gzip members searched in uncompressed offsets",
+             written && search_file(path, "needle", KMP_COMPRESSION_AUTO, positions) == 4 &&
+             memcmp(positions + 1, expected, sizeof(expected)) == 0);
+
+    FILE* out = fopen(path, "r+b");
+    if (out) {
+        fseek(out, -12, SEEK_END);
+        fputs("corrupt!", out);
+        fclose(out);
+    }
+    memset(positions, 0, sizeof(positions));
+    run_test("Corrupt gzip reports error",
+             search_file(path, "needle", KMP_COMPRESSION_GZIP, positions) == -1);
+#endif
+
+    KMPMatcher* matcher = kmp_create("x");
+    run_test("Compressed search rejects bad fd",
+             kmp_search_compressed(matcher, -1, KMP_COMPRESSION_NONE,
+                                   record_stream_match, positions) == -1);
+    kmp_destroy(matcher);
+
+    unlink(path);
+    free(text);
+}
+
+static void* metrics_search_worker(void* arg) {
+    KMPMatcher* matcher = (KMPMatcher*)arg;
+    for (int i = 0; i < 2000; i++) {
+        kmp_search(matcher, "XXABC");
+    }
+    return NULL;
+}
+
+void test_metrics() {
+    printf("\n=== Testing Metrics ===\n");
+
+    run_test("Metrics bucket exact below 16ns", kmp_metrics_bucket(7) == 7);
+    run_test("Metrics bucket floor round trip",
+             kmp_metrics_bucket_floor(kmp_metrics_bucket(1000)) <= 1000 &&
+             kmp_metrics_bucket_floor(kmp_metrics_bucket(1000) + 1) > 1000);
+
+    kmp_metrics_enable(true);
+    kmp_metrics_reset();
+
+    KMPMatcher* matcher = kmp_create("ABC");
+    if (matcher) {
+        int count;
+        kmp_search(matcher, "XXABC");
+        kmp_free(kmp_search_all(matcher, "ABCABC", &count));
+        kmp_destroy(matcher);
+    }
+
+    KMPMetricsSnapshot snapshot;
+    kmp_metrics_snapshot(&snapshot);
+    run_test("Metrics count searches and matches",
+             snapshot.searches == 2 && snapshot.matches == 3 && snapshot.bytes_scanned == 11);
+    run_test("Metrics count engine calls", snapshot.engine_calls[KMP_ENGINE_LPS] == 2);
+    run_test("Metrics percentile within recorded range",
+             kmp_metrics_percentile(&snapshot, 99.0) <= snapshot.latency_sum_ns);
+
+    FILE* out = tmpfile();
+    bool exported = false;
+    if (out) {
+        char line[256];
+        kmp_metrics_write_prometheus(out);
+        rewind(out);
+        while (fgets(line, sizeof(line), out)) {
+            if (strcmp(line, "kmp_search_latency_seconds_count 2\n") == 0) {
+                exported = true;
+            }
+        }
+        fclose(out);
+    }
+    run_test("Metrics Prometheus export", exported);
+
+    matcher = kmp_create("ABC");
+    pthread_t threads[4];
+    int started = 0;
+    for (int i = 0; matcher && i < 4; i++) {
+        if (pthread_create(&threads[i], NULL, metrics_search_worker, matcher) == 0) {
+            started++;
+        }
+    }
+    for (int i = 0; i < 50; i++) {
+        kmp_metrics_reset();
+        sched_yield();
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    kmp_metrics_snapshot(&snapshot);
+    bool bounded = snapshot.searches <= (unsigned long long)started * 2000;
+    kmp_metrics_reset();
+    kmp_metrics_snapshot(&snapshot);
+    run_test("Metrics reset while threads record", matcher && started == 4 && bounded &&
+             snapshot.searches == 0 && snapshot.latency_buckets[0] == 0);
+    kmp_destroy(matcher);
+
+    kmp_metrics_enable(false);
+    kmp_metrics_reset();
+}
+
+void test_text_index() {
+    printf("\n=== Testing Text Index ===\n");
+
+    const char* text = "MISSISSIPPI RIVER MISSISSIPPI";
+    KMPIndex* index = kmp_index_build(text, strlen(text));
+    run_test("Index built", index != NULL);
+    if (!index) {
+        return;
+    }
+
+    run_test("Index counts overlapping matches", kmp_index_count(index, "ISSI", 4) == 4);
+    run_test("Index counts missing pattern", kmp_index_count(index, "MISSOURI", 8) == 0);
+    run_test("Index counts pattern at text end", kmp_index_count(index, "PPI", 3) == 2);
+
+    const char* patterns[] = {"SS", "I", "MISSISSIPPI", "R", " "};
+    bool agrees = true;
+    for (int i = 0; i < 5; i++) {
+        KMPMatcher* matcher = kmp_create(patterns[i]);
+        int expected_count, count;
+        int* expected = kmp_search_all(matcher, text, &expected_count);
+        int* located = kmp_index_locate(index, patterns[i], strlen(patterns[i]), &count);
+        agrees = agrees && same_positions(expected, expected_count, located, count);
+        kmp_free(expected);
+        kmp_free(located);
+        kmp_destroy(matcher);
+    }
+    run_test("Index locate agrees with KMP", agrees);
+
+    char path[] = "/tmp/kmp_index_test_XXXXXX";
+    int fd = mkstemp(path);
+    bool reloaded = false;
+    bool corrupt_rejected = false;
+    bool truncated_rejected = false;
+    if (fd >= 0) {
+        if (kmp_index_save(index, path) == KMP_SUCCESS) {
+            KMPIndex* loaded = kmp_index_load(path);
+            int count;
+            int* located = kmp_index_locate(loaded, "SSI", 3, &count);
+            reloaded = loaded && kmp_index_count(loaded, "ISSI", 4) == 4 &&
+                       count == 4 && located[0] == 2 && located[3] == 23;
+            kmp_free(located);
+            kmp_index_destroy(loaded);
+
+            off_t size = lseek(fd, 0, SEEK_END);
+            int bad = INT_MAX;
+            if (pwrite(fd, &bad, sizeof(bad), size - (off_t)sizeof(bad)) == sizeof(bad)) {
+                corrupt_rejected = kmp_index_load(path) == NULL;
+            }
+            if (ftruncate(fd, size - 1) == 0) {
+                truncated_rejected = kmp_index_load(path) == NULL;
+            }
+        }
+        close(fd);
+        unlink(path);
+    }
+    run_test("Index save and mmap load", reloaded);
+    run_test("Index load rejects out-of-range suffix", corrupt_rejected);
+    run_test("Index load rejects truncated file", truncated_rejected);
+    run_test("Index load rejects missing file", kmp_index_load("/nonexistent/index") == NULL);
+
+    kmp_index_destroy(index);
+}
+
+static bool replace_bytewise(const char* pattern, const char* text,
+                             const char* replacement, const char* expected) {
+    FILE* out = tmpfile();
+    if (!out) {
+        return false;
+    }
+
+    KMPMatcher* matcher = kmp_create(pattern);
+    KMPOutputSink sink = {fileno(out), 0};
+    KMPReplacer* replacer = kmp_replacer_create(matcher, replacement, &sink);
+    kmp_destroy(matcher);
+
+    bool ok = replacer != NULL;
+    for (size_t i = 0; ok && i < strlen(text); i++) {
+        char byte = text[i];
+        ok = kmp_replacer_feed(replacer, &byte, 1) == KMP_SUCCESS;
+    }
+    ok = ok && kmp_replacer_finish(replacer) == KMP_SUCCESS;
+    kmp_replacer_destroy(replacer);
+
+    char buffer[256] = {0};
+    rewind(out);
+    size_t got = fread(buffer, 1, sizeof(buffer) - 1, out);
+    fclose(out);
+
+    return ok && got == strlen(expected) && sink.bytes_written == got &&
+           strcmp(buffer, expected) == 0;
+}
+
+void test_stream_replace() {
+    printf("\n=== Testing Streaming Replace ===\n");
+
+    run_test("Replace across one-byte chunks",
+             replace_bytewise("foo", "foo bar foofoo fo", "X", "X bar XX fo"));
+    run_test("Replace is non-overlapping", replace_bytewise("aa", "aaa", "b", "ba"));
+    run_test("Replace after partial-match fallback",
+             replace_bytewise("abab", "abaabab", "X", "abaX"));
+    run_test("Replace with empty replacement", replace_bytewise("-", "a-b--c", "", "abc"));
+
+    int fds[2];
+    FILE* out = tmpfile();
+    bool piped = false;
+    if (out && pipe(fds) == 0) {
+        const char* input = "one two one two";
+        if (write(fds[1], input, strlen(input)) == (ssize_t)strlen(input)) {
+            close(fds[1]);
+            KMPMatcher* matcher = kmp_create("two");
+            KMPOutputSink sink = {fileno(out), 0};
+            long long replaced = kmp_replace_stream(matcher, fds[0], "2", &sink);
+            kmp_destroy(matcher);
+
+            char buffer[64] = {0};
+            rewind(out);
+            size_t got = fread(buffer, 1, sizeof(buffer) - 1, out);
+            piped = replaced == 2 && got == 11 && strcmp(buffer, "one 2 one 2") == 0;
+        }
+        close(fds[0]);
+    }
+    if (out) fclose(out);
+    run_test("Replace stream from pipe", piped);
+}
+
+void test_packed_dna() {
+    printf("\n=== Testing Packed DNA ===\n");
+
+    KMPPackedSeq* invalid = kmp_packed_from_string("ACGN", 4);
+    run_test("Packed rejects non-ACGT base", invalid == NULL);
+
+    char text[201];
+    const char* bases = "ACGT";
+    for (int i = 0; i < 200; i++) {
+        text[i] = bases[(i * 7 + i / 5) % 4];
+    }
+    text[200] = '\0';
+
+    KMPPackedSeq* packed = kmp_packed_from_string(text, 200);
+    run_test("Packed text round trip", packed && kmp_packed_base_at(packed, 0) == text[0] &&
+             kmp_packed_base_at(packed, 63) == text[63] &&
+             kmp_packed_base_at(packed, 199) == text[199]);
+    run_test("Packed uses 2 bits per base", packed && packed->word_count == 8);
+
+    int lengths[] = {1, 5, 31, 32, 33, 70};
+    bool agrees = packed != NULL;
+    for (int k = 0; agrees && k < 6; k++) {
+        char pattern[71];
+        memcpy(pattern, text + 97, lengths[k]);
+        pattern[lengths[k]] = '\0';
+
+        KMPMatcher* matcher = kmp_create(pattern);
+        KMPPackedSeq* packed_pattern = kmp_packed_from_string(pattern, lengths[k]);
+        int expected_count;
+        size_t count;
+        int* expected = kmp_search_all(matcher, text, &expected_count);
+        size_t* positions = kmp_packed_search_all(packed, packed_pattern, &count);
+
+        agrees = (int)count == expected_count;
+        for (size_t i = 0; agrees && i < count; i++) {
+            agrees = positions[i] == (size_t)expected[i];
+        }
+
+        kmp_free(expected);
+        kmp_free(positions);
+        kmp_destroy(matcher);
+        kmp_packed_destroy(packed_pattern);
+    }
+    run_test("Packed search agrees with KMP", agrees);
+
+    /* Periodic inputs where every window passes the 32-base filter. */
+    char runs[601];
+    for (int i = 0; i < 600; i++) {
+        runs[i] = i % 150 == 149 ? 'C' : (i < 300 ? 'A' : "AG"[i % 2]);
+    }
+    runs[600] = '\0';
+    const char* long_patterns[] = {
+        "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA",
+        "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAC",
+        "AGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAG",
+        "AGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAGAC"
+    };
+    KMPPackedSeq* packed_runs = kmp_packed_from_string(runs, 600);
+    agrees = packed_runs != NULL;
+    for (int k = 0; agrees && k < 4; k++) {
+        KMPMatcher* matcher = kmp_create(long_patterns[k]);
+        KMPPackedSeq* packed_pattern = kmp_packed_from_string(long_patterns[k],
+                                                              strlen(long_patterns[k]));
+        int expected_count;
+        size_t count;
+        int* expected = kmp_search_all(matcher, runs, &expected_count);
+        size_t* positions = kmp_packed_search_all(packed_runs, packed_pattern, &count);
+
+        agrees = (int)count == expected_count;
+        for (size_t i = 0; agrees && i < count; i++) {
+            agrees = positions[i] == (size_t)expected[i];
+        }
+
+        kmp_free(expected);
+        kmp_free(positions);
+        kmp_destroy(matcher);
+        kmp_packed_destroy(packed_pattern);
+    }
+    run_test("Packed search handles periodic long patterns", agrees);
+    kmp_packed_destroy(packed_runs);
+
+    KMPPackedSeq* lower = kmp_packed_from_string("acgtacgt", 8);
+    KMPPackedSeq* probe = kmp_packed_from_string("GTA", 3);
+    size_t count;
+    size_t* positions = kmp_packed_search_all(lower, probe, &count);
+    run_test("Packed search is case-insensitive", count == 1 && positions && positions[0] == 2);
+    kmp_free(positions);
+
+    kmp_packed_destroy(lower);
+    kmp_packed_destroy(probe);
+    kmp_packed_destroy(packed);
+}
+
+void test_incremental_stream() {
+    printf("\n=== Testing Incremental Stream ===\n");
+
+    KMPMatcher* matcher = kmp_create("ERROR");
+    size_t positions[8] = {0};
+    KMPStream* stream = kmp_stream_create(matcher, record_stream_match, positions);
+    kmp_destroy(matcher);
+    run_test("Stream created", stream != NULL);
+    if (!stream) {
+        return;
+    }
+
+    int first = kmp_append(stream, "ok\nERR", 6);
+    int second = kmp_append(stream, "OR x\nERROR\n", 12);
+    run_test("Match spanning appends reported once",
+             first == 0 && second == 2 && positions[0] == 2 &&
+             positions[1] == 3 && positions[2] == 11);
+    run_test("Stream tracks offset and count",
+             kmp_stream_offset(stream) == 18 && stream->match_count == 2);
+
+    kmp_append(stream, "ERR", 3);
+    kmp_stream_reset(stream);
+    int rotated = kmp_append(stream, "OR ERROR", 8);
+    run_test("Reset forgets partial match and offset",
+             rotated == 1 && positions[3] == 3 && kmp_stream_offset(stream) == 8);
+
+    run_test("Append to NULL stream", kmp_append(NULL, "ERROR", 5) == -1);
+    kmp_stream_destroy(stream);
+}
+
+void test_deferred_compile() {
+    printf("\n=== Testing Deferred Compilation ===\n");
+
+    KMPOptions options = {KMP_OPTION_DEFERRED, KMP_ENGINE_LPS, NULL, 0};
+    KMPMatcher* matcher = kmp_create_ex("DEFERRED", &options);
+    run_test("Deferred matcher created", matcher != NULL);
+    if (!matcher) {
+        return;
+    }
+
+    run_test("Deferred matcher not compiled", !matcher->is_compiled && matcher->lps == NULL);
+    size_t recorded_usage = matcher->memory_usage;
+
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) {
+        pthread_create(&threads[i], NULL, deferred_search_worker, matcher);
+    }
+
+    bool all_found = true;
+    for (int i = 0; i < 4; i++) {
+        void* found;
+        pthread_join(threads[i], &found);
+        all_found = all_found && found;
+    }
+
+    run_test("Concurrent first searches compile once", all_found && matcher->is_compiled);
+    run_test("Compiled memory usage includes tables", matcher->memory_usage > recorded_usage);
+    run_test("Compile is idempotent", kmp_compile(matcher) == KMP_SUCCESS);
+
+    kmp_destroy(matcher);
+    run_test("Compile NULL matcher", kmp_compile(NULL) == KMP_ERROR_NULL_POINTER);
+}
+
+void test_pattern_cache() {
+    printf("\n=== Testing Pattern Cache ===\n");
+
+    kmp_cache_clear();
+    kmp_cache_set_budget(1024 * 1024);
+
+    KMPMatcher* first = kmp_cache_get("NEEDLE", 6);
+    KMPMatcher* second = kmp_cache_get("NEEDLE", 6);
+    run_test("Cache returns shared matcher", first && first == second);
+    run_test("Cached matcher searches", first && kmp_search(first, "HAYNEEDLE") == 3);
+
+    KMPMatcher* prefix = kmp_cache_get("NEEDLEX", 4);
+    run_test("Cache keys on pattern bytes", prefix && prefix != first &&
+             prefix->pattern_len == 4 && strcmp(prefix->pattern, "NEED") == 0);
+    run_test("Cache rejects embedded NUL", kmp_cache_get("AB\0C", 4) == NULL);
+
+    KMPCacheStats stats;
+    kmp_cache_get_stats(&stats);
+    run_test("Cache counts hits and misses", stats.hits == 1 && stats.misses == 3);
+    run_test("Cache tracks entries and bytes", stats.entries == 2 && stats.bytes > 0);
+
+    kmp_release(first);
+    kmp_release(second);
+    kmp_release(prefix);
+
+    kmp_cache_set_budget(0);
+    kmp_cache_get_stats(&stats);
+    run_test("Shrinking budget evicts entries", stats.entries == 0 && stats.evictions == 2);
+
+    /* A shard's budget fits exactly one large pattern, so admitting one
+     * into a shard full of small entries has to evict all of them at once. */
+    static char large[16001];
+    memset(large, 'L', 16000);
+    KMPMatcher* probe = kmp_create(large);
+    size_t budget = probe ? (probe->memory_usage + 64) * 16 : 0;
+    kmp_destroy(probe);
+    kmp_cache_set_budget(budget);
+    for (int i = 0; i < 640; i++) {
+        char small[16];
+        int len = sprintf(small, "small%d", i);
+        kmp_release(kmp_cache_get(small, len));
+    }
+    kmp_cache_get_stats(&stats);
+    unsigned long long evictions = stats.evictions;
+    unsigned long long most_at_once = 0;
+    bool within_budget = budget > 0;
+    for (int i = 0; i < 64; i++) {
+        sprintf(large, "%04d", i);
+        large[4] = 'L';
+        kmp_release(kmp_cache_get(large, 16000));
+        kmp_cache_get_stats(&stats);
+        if (stats.evictions - evictions > most_at_once) {
+            most_at_once = stats.evictions - evictions;
+        }
+        evictions = stats.evictions;
+        within_budget = within_budget && stats.bytes <= budget;
+    }
+    run_test("Admission evicts until under budget", within_budget && most_at_once > 8);
+
+    kmp_cache_set_budget(8 * 1024 * 1024);
+    kmp_cache_clear();
+}
+
 void print_test_summary() {
     printf("\n=== Test Summary ===\n");
     printf("Total tests: %d\n", test_count);
@@ -245,12 +1419,30 @@ int main() {
     printf("========================\n");
 
     test_lps_computation();
+    test_failure_tables();
     test_basic_search();
     test_multiple_search();
     test_edge_cases();
     test_memory_management();
+    test_allocator_hooks();
     test_ascii_validation();
     test_utility_functions();
+    test_shared_matcher();
+    test_pattern_cache();
+    test_deferred_compile();
+    test_incremental_stream();
+    test_engine_planner();
+    test_strong_engine();
+    test_range_search();
+    test_parallel_search();
+    test_huge_pages();
+    test_multi_pattern();
+    test_compressed_positions();
+    test_compressed_search();
+    test_metrics();
+    test_text_index();
+    test_stream_replace();
+    test_packed_dna();
 
     print_test_summary();
 
@@ -0,0 +1,101 @@
+#include "../include/kmp.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ranges>
+#include <vector>
+
+static int test_count = 0;
+static int test_passed = 0;
+
+static void run_test(const char* test_name, bool condition) {
+    test_count++;
+    if (condition) {
+        test_passed++;
+        std::printf("PASS: %s\n", test_name);
+    } else {
+        std::printf("FAIL: %s\n", test_name);
+    }
+}
+
+static_assert(kmp::matcher<"ABABCABAB">::lps[8] == 4);
+static_assert(kmp::matcher<"AA">::count("AAAA") == 3);
+static_assert(kmp::matcher<"needle">::find("haystack needle") == 9);
+static_assert(!kmp::matcher<"needle">::find("haystack"));
+static_assert(std::ranges::forward_range<kmp::match_range>);
+static_assert(std::ranges::view<kmp::match_range>);
+
+/* Offsets of the first two "ABA" matches, shifted by one, at compile time. */
+constexpr std::size_t first_two_shifted() {
+    std::size_t sum = 0;
+    for (std::size_t end : kmp::matcher<"ABA">::find_all("ABABABA") | std::views::take(2) |
+                               std::views::transform([](std::size_t p) { return p + 1; })) {
+        sum += end;
+    }
+    return sum;
+}
+static_assert(first_two_shifted() == 4);
+
+static void test_fixed_matcher() {
+    using aba = kmp::matcher<"ABA">;
+    std::vector<std::size_t> offsets;
+    for (std::size_t offset : aba::find_all("xABABABAx") | std::views::take(2)) {
+        offsets.push_back(offset);
+    }
+    run_test("Fixed matcher works with views::take",
+             offsets == std::vector<std::size_t>{1, 3});
+
+    auto ends = aba::find_all("xABABABAx") |
+                std::views::transform([](std::size_t p) { return p + aba::size; });
+    run_test("Fixed matcher works with views::transform",
+             std::ranges::distance(ends) == 3 && *std::ranges::begin(ends) == 4);
+
+    const std::byte bytes[] = {std::byte{'A'}, std::byte{0}, std::byte{'A'},
+                               std::byte{'B'}, std::byte{'A'}};
+    auto byte_matches = aba::find_all(std::span<const std::byte>(bytes));
+    run_test("Fixed matcher searches byte spans",
+             std::ranges::distance(byte_matches) == 1 && *byte_matches.begin() == 2);
+}
+
+static void* failing_malloc(std::size_t, void*) { return nullptr; }
+static void* failing_realloc(void*, std::size_t, void*) { return nullptr; }
+static void failing_free(void* ptr, void*) { std::free(ptr); }
+
+static void test_adopted_matcher() {
+    KMPOptions options = {};
+    options.flags = KMP_OPTION_DEFERRED;
+
+    kmp::dynamic_matcher deferred(kmp_create_ex("ABA", &options));
+    run_test("Adopted deferred matcher is compiled",
+             deferred && deferred.get()->is_compiled && deferred.get()->lps != nullptr);
+    run_test("Adopted deferred matcher searches", deferred.find("xxABABA") == 2);
+
+    kmp::dynamic_matcher copy = deferred;
+    run_test("Copy shares the adopted matcher",
+             copy.get() == deferred.get() && copy.get()->refcount == 2);
+
+    KMPMemoryCounter before;
+    kmp_memory_stats(&before);
+    KMPMatcher* pending = kmp_create_ex("needle", &options);
+    const KMPAllocator failing = {failing_malloc, failing_realloc, failing_free, nullptr};
+    kmp_set_allocator(&failing);
+    kmp::dynamic_matcher failed(pending);
+    kmp_set_allocator(nullptr);
+    run_test("Failed compile leaves an empty handle", !failed && !failed.find("needle"));
+
+    KMPMemoryCounter after;
+    kmp_memory_stats(&after);
+    run_test("Failed compile releases the matcher", after.live_bytes == before.live_bytes);
+}
+
+int main() {
+    std::printf("KMP C++ Wrapper Tests\n");
+    std::printf("=====================\n");
+
+    test_fixed_matcher();
+    test_adopted_matcher();
+
+    std::printf("\nTotal: %d\nPassed: %d\nFailed: %d\n", test_count, test_passed,
+                test_count - test_passed);
+    return test_passed == test_count ? 0 : 1;
+}
@@ -0,0 +1,293 @@
+#define _GNU_SOURCE
+#include "../tools/kmpd_proto.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PIPELINED_FRAMES 300
+
+int test_count = 0;
+int test_passed = 0;
+
+void run_test(const char* test_name, bool condition) {
+    test_count++;
+    if (condition) {
+        test_passed++;
+        printf("PASS: %s\n", test_name);
+    } else {
+        printf("FAIL: %s\n", test_name);
+    }
+}
+
+static bool write_all(int fd, const unsigned char* data, size_t len) {
+    while (len > 0) {
+        ssize_t sent = send(fd, data, len, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+static bool read_all(int fd, unsigned char* data, size_t len) {
+    while (len > 0) {
+        ssize_t received = recv(fd, data, len, 0);
+        if (received <= 0) {
+            if (received < 0 && errno == EINTR) continue;
+            return false;
+        }
+        data += received;
+        len -= received;
+    }
+    return true;
+}
+
+/* Reads one response frame; the caller frees the returned payload. */
+static unsigned char* read_response(int fd, uint32_t* len) {
+    unsigned char header[4];
+    if (!read_all(fd, header, 4)) {
+        return NULL;
+    }
+    *len = kmpd_get_u32(header);
+    unsigned char* payload = (unsigned char*)malloc(*len ? *len : 1);
+    if (payload && !read_all(fd, payload, *len)) {
+        free(payload);
+        return NULL;
+    }
+    return payload;
+}
+
+/* Writes a request frame with the given texts to frame, which must be large
+ * enough, and returns its length. */
+static size_t build_request(unsigned char* frame, uint32_t request_id,
+                            const char* const* texts, uint32_t text_count) {
+    size_t payload_len = 8;
+    for (uint32_t t = 0; t < text_count; t++) {
+        payload_len += 4 + strlen(texts[t]);
+    }
+
+    unsigned char* p = frame;
+    kmpd_put_u32(p, (uint32_t)payload_len);
+    kmpd_put_u32(p + 4, request_id);
+    kmpd_put_u32(p + 8, text_count);
+    p += 12;
+    for (uint32_t t = 0; t < text_count; t++) {
+        size_t len = strlen(texts[t]);
+        kmpd_put_u32(p, (uint32_t)len);
+        memcpy(p + 4, texts[t], len);
+        p += 4 + len;
+    }
+    return 4 + payload_len;
+}
+
+static int connect_socket(const char* path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    /* The daemon binds its socket shortly after it starts. */
+    for (int attempt = 0; attempt < 500; attempt++) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+            return fd;
+        }
+        close(fd);
+        struct timespec delay = {0, 10 * 1000 * 1000};
+        nanosleep(&delay, NULL);
+    }
+    return -1;
+}
+
+static pid_t start_daemon(const char* daemon, const char* patterns, const char* socket_path) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (!freopen("/dev/null", "w", stdout)) {
+            _exit(127);
+        }
+        execl(daemon, daemon, "-p", patterns, "-s", socket_path, "-w", "2", (char*)NULL);
+        _exit(127);
+    }
+    return pid;
+}
+
+static void test_valid_frame(int fd) {
+    static const char* texts[] = {"xxABABAneedle", "", "no match here"};
+    unsigned char frame[128];
+    size_t len = build_request(frame, 7, texts, 3);
+
+    uint32_t response_len = 0;
+    unsigned char* response = write_all(fd, frame, len) ? read_response(fd, &response_len) : NULL;
+
+    /* Text 0: "ABA" at 2 and 4, then "needle" at 7; texts 1 and 2: none. */
+    static const uint32_t expected[] = {7, 3, 3, 0, 2, 0, 4, 1, 7, 0, 0};
+    bool matches = response && response_len == sizeof(expected);
+    for (size_t i = 0; matches && i < sizeof(expected) / 4; i++) {
+        matches = kmpd_get_u32(response + 4 * i) == expected[i];
+    }
+    run_test("Valid frame gets its matches", matches);
+    free(response);
+}
+
+/* Texts of a batch share one scan, but a match may not span two texts. */
+static void test_text_boundaries(int fd) {
+    static const char* texts[] = {"xxAB", "Axx", "nee", "dleABA"};
+    unsigned char frame[128];
+    size_t len = build_request(frame, 9, texts, 4);
+
+    uint32_t response_len = 0;
+    unsigned char* response = write_all(fd, frame, len) ? read_response(fd, &response_len) : NULL;
+
+    static const uint32_t expected[] = {9, 4, 0, 0, 0, 1, 0, 3};
+    bool matches = response && response_len == sizeof(expected);
+    for (size_t i = 0; matches && i < sizeof(expected) / 4; i++) {
+        matches = kmpd_get_u32(response + 4 * i) == expected[i];
+    }
+    run_test("Matches never span two texts", matches);
+    free(response);
+}
+
+static void test_malformed_frames(int fd) {
+    unsigned char frame[16];
+    uint32_t response_len = 0;
+
+    /* Claims five texts but carries none. */
+    kmpd_put_u32(frame, 8);
+    kmpd_put_u32(frame + 4, 11);
+    kmpd_put_u32(frame + 8, 5);
+    unsigned char* response = write_all(fd, frame, 12) ? read_response(fd, &response_len) : NULL;
+    run_test("Text count past payload is a bad request",
+             response && response_len == 8 && kmpd_get_u32(response) == 11 &&
+             kmpd_get_u32(response + 4) == KMPD_BAD_REQUEST);
+    free(response);
+
+    /* Too short to hold the request header. */
+    kmpd_put_u32(frame, 2);
+    frame[4] = 'x';
+    frame[5] = 'y';
+    response = write_all(fd, frame, 6) ? read_response(fd, &response_len) : NULL;
+    run_test("Truncated payload is a bad request",
+             response && response_len == 8 && kmpd_get_u32(response + 4) == KMPD_BAD_REQUEST);
+    free(response);
+
+    static const char* texts[] = {"ABA"};
+    size_t len = build_request(frame, 12, texts, 1);
+    response = write_all(fd, frame, len) ? read_response(fd, &response_len) : NULL;
+    run_test("Connection still serves after bad requests",
+             response && response_len == 20 && kmpd_get_u32(response) == 12 &&
+             kmpd_get_u32(response + 8) == 1);
+    free(response);
+}
+
+/* Sends every frame in one write, past the daemon's per-connection
+ * in-flight limit, then reads all the answers back. Workers may finish the
+ * frames out of order, so responses are matched by request id. */
+static void test_pipelined_frames(int fd) {
+    static const char* texts[] = {"ABABA", "needle in a haystack"};
+    unsigned char scratch[64];
+    size_t frame_len = build_request(scratch, 0, texts, 2);
+    unsigned char* frames = (unsigned char*)malloc(frame_len * PIPELINED_FRAMES);
+    bool* seen = (bool*)calloc(PIPELINED_FRAMES, sizeof(bool));
+    if (!frames || !seen) {
+        free(frames);
+        free(seen);
+        run_test("Pipelined frames all answered", false);
+        return;
+    }
+
+    for (uint32_t r = 0; r < PIPELINED_FRAMES; r++) {
+        build_request(frames + r * frame_len, r, texts, 2);
+    }
+
+    bool ok = write_all(fd, frames, frame_len * PIPELINED_FRAMES);
+    int answered = 0;
+    for (int r = 0; ok && r < PIPELINED_FRAMES; r++) {
+        uint32_t response_len = 0;
+        unsigned char* response = read_response(fd, &response_len);
+        /* "ABABA": ABA at 0 and 2; the second text: needle at 0. */
+        ok = response && response_len == 40;
+        uint32_t id = ok ? kmpd_get_u32(response) : 0;
+        ok = ok && id < PIPELINED_FRAMES && !seen[id] && kmpd_get_u32(response + 4) == 2 &&
+             kmpd_get_u32(response + 8) == 2 && kmpd_get_u32(response + 28) == 1 &&
+             kmpd_get_u32(response + 32) == 1 && kmpd_get_u32(response + 36) == 0;
+        if (ok) {
+            seen[id] = true;
+            answered++;
+        }
+        free(response);
+    }
+    run_test("Pipelined frames all answered", answered == PIPELINED_FRAMES);
+
+    free(frames);
+    free(seen);
+}
+
+int main(int argc, char* argv[]) {
+    const char* daemon = argc > 1 ? argv[1] : "./kmpd";
+
+    printf("kmpd Protocol Tests\n");
+    printf("===================\n");
+
+    char dir[] = "/tmp/kmpd_test_XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    char patterns[64];
+    char socket_path[64];
+    snprintf(patterns, sizeof(patterns), "%s/patterns", dir);
+    snprintf(socket_path, sizeof(socket_path), "%s/kmpd.sock", dir);
+
+    FILE* file = fopen(patterns, "w");
+    if (!file) {
+        perror(patterns);
+        rmdir(dir);
+        return 1;
+    }
+    fputs("ABA\nneedle\n", file);
+    fclose(file);
+
+    pid_t pid = start_daemon(daemon, patterns, socket_path);
+    int fd = pid > 0 ? connect_socket(socket_path) : -1;
+    run_test("Daemon accepts connections", fd >= 0);
+
+    if (fd >= 0) {
+        test_valid_frame(fd);
+        test_text_boundaries(fd);
+        test_malformed_frames(fd);
+        test_pipelined_frames(fd);
+        close(fd);
+    }
+
+    int status = 0;
+    if (pid > 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, &status, 0);
+    }
+    run_test("Daemon stops cleanly on SIGTERM",
+             pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    unlink(socket_path);
+    unlink(patterns);
+    rmdir(dir);
+
+    printf("\nTotal tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passed);
+    printf("Failed: %d\n", test_count - test_passed);
+    return test_passed == test_count ? 0 : 1;
+}
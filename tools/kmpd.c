@@ -0,0 +1,820 @@
+#define _GNU_SOURCE
+#include "../include/kmp.h"
+#include "kmpd_proto.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define KMPD_MAX_CONNECTIONS 4096
+#define KMPD_MAX_EVENTS 64
+#define KMPD_COALESCE_JOBS 32
+#define KMPD_COALESCE_BYTES (256u * 1024u)
+#define KMPD_MAX_IN_FLIGHT 64
+#define KMPD_MAX_PENDING_OUTPUT (4u * 1024u * 1024u)
+
+typedef struct {
+    unsigned char* data;
+    size_t len;
+    size_t cap;
+} Buffer;
+
+typedef struct {
+    bool open;
+    unsigned int generation;
+    Buffer in;
+    Buffer out;
+    size_t out_sent;
+    int in_flight;
+    uint32_t events;
+} Connection;
+
+typedef struct Job {
+    int fd;
+    unsigned int generation;
+    unsigned char* payload;
+    uint32_t payload_len;
+    Buffer response;
+    struct Job* next;
+} Job;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    Job* head;
+    Job* tail;
+} JobQueue;
+
+typedef struct {
+    Job* job;
+    uint32_t text_count;
+    const unsigned char** texts;
+    uint32_t* lengths;
+    Buffer* matches;
+    bool failed;
+} ParsedJob;
+
+/* One text of a batch, copied to [start, end) of the batch arena. */
+typedef struct {
+    size_t start;
+    size_t end;
+    ParsedJob* parsed;
+    Buffer* matches;
+} BatchText;
+
+typedef struct {
+    BatchText* texts;
+    size_t text_count;
+    size_t current;
+    uint32_t pattern_index;
+    size_t pattern_len;
+} MatchSink;
+
+static KMPMatcher** patterns;
+static int pattern_count;
+static Connection connections[KMPD_MAX_CONNECTIONS];
+static JobQueue pending = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, NULL};
+static JobQueue finished = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, NULL};
+static int wake_fd = -1;
+/* Set from the signal handler and read by the workers, so it is only
+ * touched through lock-free atomics. */
+static int stopping = 0;
+
+static bool buffer_reserve(Buffer* buffer, size_t extra) {
+    if (buffer->len + extra <= buffer->cap) {
+        return true;
+    }
+
+    size_t cap = buffer->cap ? buffer->cap : 256;
+    while (cap < buffer->len + extra) {
+        cap *= 2;
+    }
+
+    unsigned char* data = (unsigned char*)realloc(buffer->data, cap);
+    if (!data) {
+        return false;
+    }
+    buffer->data = data;
+    buffer->cap = cap;
+    return true;
+}
+
+static bool buffer_append(Buffer* buffer, const void* data, size_t len) {
+    if (len == 0) {
+        return true;
+    }
+    if (!buffer_reserve(buffer, len)) {
+        return false;
+    }
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+    return true;
+}
+
+static bool buffer_append_u32(Buffer* buffer, uint32_t value) {
+    unsigned char bytes[4];
+    kmpd_put_u32(bytes, value);
+    return buffer_append(buffer, bytes, 4);
+}
+
+static void buffer_free(Buffer* buffer) {
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->len = 0;
+    buffer->cap = 0;
+}
+
+static void queue_push(JobQueue* queue, Job* job) {
+    job->next = NULL;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->tail) {
+        queue->tail->next = job;
+    } else {
+        queue->head = job;
+    }
+    queue->tail = job;
+    pthread_cond_signal(&queue->ready);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/* Takes every queued job up to the coalescing limits, blocking only while the
+ * queue is empty. */
+static Job* queue_take_batch(JobQueue* queue) {
+    pthread_mutex_lock(&queue->lock);
+    while (!queue->head && !__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) {
+        pthread_cond_wait(&queue->ready, &queue->lock);
+    }
+
+    Job* batch = queue->head;
+    Job* last = batch;
+    int jobs = batch ? 1 : 0;
+    size_t bytes = batch ? batch->payload_len : 0;
+
+    while (last && last->next && jobs < KMPD_COALESCE_JOBS &&
+           bytes + last->next->payload_len <= KMPD_COALESCE_BYTES) {
+        last = last->next;
+        bytes += last->payload_len;
+        jobs++;
+    }
+
+    if (last) {
+        queue->head = last->next;
+        if (!queue->head) {
+            queue->tail = NULL;
+        }
+        last->next = NULL;
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return batch;
+}
+
+static Job* queue_take_all(JobQueue* queue) {
+    pthread_mutex_lock(&queue->lock);
+    Job* all = queue->head;
+    queue->head = NULL;
+    queue->tail = NULL;
+    pthread_mutex_unlock(&queue->lock);
+    return all;
+}
+
+static bool parse_job(ParsedJob* parsed) {
+    const unsigned char* p = parsed->job->payload;
+    uint32_t remaining = parsed->job->payload_len;
+
+    parsed->text_count = 0;
+    parsed->texts = NULL;
+    parsed->lengths = NULL;
+    parsed->matches = NULL;
+    parsed->failed = false;
+
+    if (remaining < 8) {
+        return false;
+    }
+
+    uint32_t count = kmpd_get_u32(p + 4);
+    p += 8;
+    remaining -= 8;
+    if (count > remaining / 4) {
+        return false;
+    }
+
+    parsed->texts = (const unsigned char**)malloc((count ? count : 1) * sizeof(unsigned char*));
+    parsed->lengths = (uint32_t*)malloc((count ? count : 1) * sizeof(uint32_t));
+    parsed->matches = (Buffer*)calloc(count ? count : 1, sizeof(Buffer));
+    if (!parsed->texts || !parsed->lengths || !parsed->matches) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (remaining < 4) {
+            return false;
+        }
+        uint32_t len = kmpd_get_u32(p);
+        p += 4;
+        remaining -= 4;
+        if (len > remaining) {
+            return false;
+        }
+        parsed->texts[i] = p;
+        parsed->lengths[i] = len;
+        p += len;
+        remaining -= len;
+    }
+
+    parsed->text_count = count;
+    return remaining == 0;
+}
+
+/* Matches arrive in increasing arena order, so the sink walks the texts
+ * forward; a match that runs past the end of the text it starts in spans two
+ * texts and is dropped. Both words of a match are reserved together, so a
+ * failed allocation never leaves half an entry behind; the job is then
+ * answered with an error. */
+static void collect_match(size_t position, void* user_data) {
+    MatchSink* sink = (MatchSink*)user_data;
+    while (sink->current < sink->text_count && sink->texts[sink->current].end <= position) {
+        sink->current++;
+    }
+    if (sink->current == sink->text_count) {
+        return;
+    }
+
+    BatchText* text = &sink->texts[sink->current];
+    if (position + sink->pattern_len > text->end) {
+        return;
+    }
+    if (text->parsed->failed || !buffer_reserve(text->matches, 8)) {
+        text->parsed->failed = true;
+        return;
+    }
+    buffer_append_u32(text->matches, sink->pattern_index);
+    buffer_append_u32(text->matches, (uint32_t)(position - text->start));
+}
+
+static bool append_response(Buffer* response, uint32_t request_id,
+                            const ParsedJob* parsed, bool valid) {
+    size_t payload = 8;
+    if (valid) {
+        for (uint32_t t = 0; t < parsed->text_count; t++) {
+            payload += 4 + parsed->matches[t].len;
+        }
+    }
+    if (payload > UINT32_MAX || !buffer_reserve(response, payload + 4)) {
+        return false;
+    }
+
+    bool ok = buffer_append_u32(response, (uint32_t)payload) &&
+              buffer_append_u32(response, request_id) &&
+              buffer_append_u32(response, valid ? parsed->text_count : KMPD_BAD_REQUEST);
+    for (uint32_t t = 0; ok && valid && t < parsed->text_count; t++) {
+        ok = buffer_append_u32(response, (uint32_t)(parsed->matches[t].len / 8)) &&
+             buffer_append(response, parsed->matches[t].data, parsed->matches[t].len);
+    }
+    return ok;
+}
+
+/* A job whose matches or response frame could not be allocated is answered
+ * with KMPD_BAD_REQUEST instead of a partial frame. If even that cannot be
+ * allocated the response is left empty and the connection is dropped, since
+ * skipping a frame would desynchronise the client. */
+static void build_response(ParsedJob* parsed, bool valid) {
+    Job* job = parsed->job;
+    uint32_t request_id = job->payload_len >= 4 ? kmpd_get_u32(job->payload) : 0;
+
+    if (append_response(&job->response, request_id, parsed, valid && !parsed->failed)) {
+        return;
+    }
+    job->response.len = 0;
+    if (!append_response(&job->response, request_id, parsed, false)) {
+        job->response.len = 0;
+    }
+}
+
+/* Copies the texts of every valid job back to back into one arena so each
+ * pattern scans the whole batch in a single pass. */
+static void scan_batch(ParsedJob* parsed, const bool* valid, int job_count) {
+    size_t text_count = 0;
+    size_t bytes = 0;
+    for (int j = 0; j < job_count; j++) {
+        if (!valid[j]) continue;
+        text_count += parsed[j].text_count;
+        for (uint32_t t = 0; t < parsed[j].text_count; t++) {
+            bytes += parsed[j].lengths[t];
+        }
+    }
+
+    char* arena = (char*)malloc(bytes ? bytes : 1);
+    BatchText* texts = (BatchText*)malloc((text_count ? text_count : 1) * sizeof(BatchText));
+    if (!arena || !texts) {
+        for (int j = 0; j < job_count; j++) {
+            parsed[j].failed = true;
+        }
+        free(arena);
+        free(texts);
+        return;
+    }
+
+    size_t offset = 0;
+    size_t index = 0;
+    for (int j = 0; j < job_count; j++) {
+        if (!valid[j]) continue;
+        for (uint32_t t = 0; t < parsed[j].text_count; t++) {
+            memcpy(arena + offset, parsed[j].texts[t], parsed[j].lengths[t]);
+            texts[index].start = offset;
+            texts[index].end = offset + parsed[j].lengths[t];
+            texts[index].parsed = &parsed[j];
+            texts[index].matches = &parsed[j].matches[t];
+            offset = texts[index].end;
+            index++;
+        }
+    }
+
+    for (int p = 0; p < pattern_count; p++) {
+        KMPSearchState state;
+        MatchSink sink = {texts, text_count, 0, (uint32_t)p, (size_t)patterns[p]->pattern_len};
+        kmp_search_state_init(&state);
+        kmp_search_chunk(patterns[p], &state, arena, bytes, collect_match, &sink);
+    }
+
+    free(arena);
+    free(texts);
+}
+
+/* Small requests queued together share one scan pass per pattern over all
+ * their texts, instead of one scan per text. */
+static void process_batch(Job* batch) {
+    int job_count = 0;
+    for (Job* job = batch; job; job = job->next) {
+        job_count++;
+    }
+
+    ParsedJob* parsed = (ParsedJob*)calloc(job_count, sizeof(ParsedJob));
+    bool* valid = (bool*)calloc(job_count, sizeof(bool));
+    if (!parsed || !valid) {
+        free(parsed);
+        free(valid);
+        parsed = NULL;
+        valid = NULL;
+    }
+
+    int index = 0;
+    for (Job* job = batch; job; job = job->next, index++) {
+        if (parsed) {
+            parsed[index].job = job;
+            valid[index] = parse_job(&parsed[index]);
+        }
+    }
+
+    if (parsed) {
+        scan_batch(parsed, valid, job_count);
+    }
+
+    index = 0;
+    Job* job = batch;
+    while (job) {
+        Job* next = job->next;
+        if (parsed) {
+            build_response(&parsed[index], valid[index]);
+            for (uint32_t t = 0; t < parsed[index].text_count; t++) {
+                buffer_free(&parsed[index].matches[t]);
+            }
+            free(parsed[index].texts);
+            free(parsed[index].lengths);
+            free(parsed[index].matches);
+        } else {
+            ParsedJob unparsed = {job, 0, NULL, NULL, NULL, false};
+            build_response(&unparsed, false);
+        }
+        free(job->payload);
+        job->payload = NULL;
+        queue_push(&finished, job);
+        index++;
+        job = next;
+    }
+
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        perror("kmpd: eventfd write");
+    }
+
+    free(parsed);
+    free(valid);
+}
+
+static void* worker_main(void* arg) {
+    (void)arg;
+
+    while (!__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) {
+        Job* batch = queue_take_batch(&pending);
+        if (batch) {
+            process_batch(batch);
+        }
+    }
+
+    return NULL;
+}
+
+static void close_connection(int epoll_fd, int fd) {
+    Connection* conn = &connections[fd];
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+    buffer_free(&conn->in);
+    buffer_free(&conn->out);
+    conn->out_sent = 0;
+    conn->in_flight = 0;
+    conn->events = 0;
+    conn->open = false;
+    conn->generation++;
+}
+
+/* A connection with too many requests queued, or too many response bytes
+ * the client has not read yet, is over its limits. */
+static bool connection_saturated(const Connection* conn) {
+    return conn->in_flight >= KMPD_MAX_IN_FLIGHT ||
+           conn->out.len - conn->out_sent >= KMPD_MAX_PENDING_OUTPUT;
+}
+
+/* Reading stops while a connection is saturated, so a client that pipelines
+ * faster than it drains its responses fills its own socket buffer instead of
+ * the daemon's queues. */
+static void update_events(int epoll_fd, int fd) {
+    Connection* conn = &connections[fd];
+    uint32_t events = 0;
+
+    if (!connection_saturated(conn)) {
+        events |= EPOLLIN;
+    }
+    if (conn->out_sent < conn->out.len) {
+        events |= EPOLLOUT;
+    }
+    if (events != conn->events) {
+        struct epoll_event event = {events, {.fd = fd}};
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+        conn->events = events;
+    }
+}
+
+static bool flush_connection(int fd) {
+    Connection* conn = &connections[fd];
+
+    while (conn->out_sent < conn->out.len) {
+        ssize_t sent = send(fd, conn->out.data + conn->out_sent,
+                            conn->out.len - conn->out_sent, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        conn->out_sent += sent;
+    }
+
+    conn->out.len = 0;
+    conn->out_sent = 0;
+    return true;
+}
+
+static bool dispatch_frames(int fd) {
+    Connection* conn = &connections[fd];
+    size_t offset = 0;
+
+    while (conn->in.len - offset >= 4 && !connection_saturated(conn)) {
+        uint32_t payload_len = kmpd_get_u32(conn->in.data + offset);
+        if (payload_len > KMPD_MAX_FRAME) {
+            return false;
+        }
+        if (conn->in.len - offset - 4 < payload_len) {
+            break;
+        }
+
+        Job* job = (Job*)calloc(1, sizeof(Job));
+        if (!job) {
+            return false;
+        }
+        job->fd = fd;
+        job->generation = conn->generation;
+        job->payload_len = payload_len;
+        job->payload = (unsigned char*)malloc(payload_len ? payload_len : 1);
+        if (!job->payload) {
+            free(job);
+            return false;
+        }
+        memcpy(job->payload, conn->in.data + offset + 4, payload_len);
+        queue_push(&pending, job);
+        conn->in_flight++;
+
+        offset += 4 + payload_len;
+    }
+
+    if (offset > 0) {
+        memmove(conn->in.data, conn->in.data + offset, conn->in.len - offset);
+        conn->in.len -= offset;
+    }
+
+    return true;
+}
+
+static bool read_connection(int fd) {
+    Connection* conn = &connections[fd];
+
+    for (;;) {
+        if (connection_saturated(conn)) {
+            return true;
+        }
+        if (!buffer_reserve(&conn->in, 64 * 1024)) {
+            return false;
+        }
+        ssize_t received = recv(fd, conn->in.data + conn->in.len,
+                                conn->in.cap - conn->in.len, 0);
+        if (received > 0) {
+            conn->in.len += received;
+            if (!dispatch_frames(fd)) {
+                return false;
+            }
+            continue;
+        }
+        if (received == 0) {
+            return false;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return true;
+        }
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+static void deliver_responses(int epoll_fd) {
+    uint64_t value;
+    if (read(wake_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+        perror("kmpd: eventfd read");
+    }
+
+    Job* job = queue_take_all(&finished);
+    while (job) {
+        Job* next = job->next;
+        Connection* conn = &connections[job->fd];
+
+        if (conn->open && conn->generation == job->generation) {
+            bool was_idle = conn->out.len == 0;
+            conn->in_flight--;
+            /* Frames held back while the connection was saturated may fit
+             * again now that one of its jobs has finished. */
+            if (job->response.len == 0 ||
+                !buffer_append(&conn->out, job->response.data, job->response.len) ||
+                (was_idle && !flush_connection(job->fd)) || !dispatch_frames(job->fd)) {
+                close_connection(epoll_fd, job->fd);
+            } else {
+                update_events(epoll_fd, job->fd);
+            }
+        }
+
+        buffer_free(&job->response);
+        free(job);
+        job = next;
+    }
+}
+
+static void accept_connections(int epoll_fd, int listen_fd) {
+    for (;;) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+
+        if (fd >= KMPD_MAX_CONNECTIONS) {
+            close(fd);
+            continue;
+        }
+
+        struct epoll_event event = {EPOLLIN, {.fd = fd}};
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(fd);
+            continue;
+        }
+        connections[fd].open = true;
+        connections[fd].events = EPOLLIN;
+    }
+}
+
+static int load_patterns(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return -1;
+    }
+
+    char line[4096];
+    int capacity = 16;
+    patterns = (KMPMatcher**)malloc(capacity * sizeof(KMPMatcher*));
+    if (!patterns) {
+        fclose(file);
+        return -1;
+    }
+
+    KMPOptions options = {0, KMP_ENGINE_AUTO, NULL, 0};
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0') continue;
+
+        KMPMatcher* matcher = kmp_create_ex(line, &options);
+        if (!matcher) {
+            fprintf(stderr, "kmpd: skipping invalid pattern \"%s\"\n", line);
+            continue;
+        }
+
+        if (pattern_count >= capacity) {
+            capacity *= 2;
+            KMPMatcher** grown = (KMPMatcher**)realloc(patterns, capacity * sizeof(KMPMatcher*));
+            if (!grown) {
+                kmp_destroy(matcher);
+                break;
+            }
+            patterns = grown;
+        }
+        patterns[pattern_count++] = matcher;
+    }
+
+    fclose(file);
+    return pattern_count;
+}
+
+static int open_listener(const char* path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "kmpd: socket path too long\n");
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 128) < 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static void handle_signal(int signo) {
+    (void)signo;
+    __atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+}
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s -p PATTERN_FILE [-s SOCKET] [-w WORKERS]\n", program_name);
+    printf("  -p FILE     Patterns to precompile, one per line\n");
+    printf("  -s SOCKET   Unix socket path (default %s)\n", KMPD_DEFAULT_SOCKET);
+    printf("  -w WORKERS  Worker threads (default: online CPUs)\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* pattern_file = NULL;
+    const char* socket_path = KMPD_DEFAULT_SOCKET;
+    int workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            pattern_file = argv[++i];
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "-h") == 0 ? 0 : 1;
+        }
+    }
+
+    if (!pattern_file) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (workers < 1) {
+        workers = 1;
+    }
+
+    if (load_patterns(pattern_file) <= 0) {
+        fprintf(stderr, "kmpd: no patterns loaded\n");
+        return 1;
+    }
+
+    int listen_fd = open_listener(socket_path);
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (listen_fd < 0 || epoll_fd < 0 || wake_fd < 0) {
+        return 1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_signal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    struct epoll_event event = {EPOLLIN, {.fd = listen_fd}};
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+    event.data.fd = wake_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+
+    pthread_t* threads = (pthread_t*)malloc(workers * sizeof(pthread_t));
+    if (!threads) {
+        return 1;
+    }
+    for (int i = 0; i < workers; i++) {
+        pthread_create(&threads[i], NULL, worker_main, NULL);
+    }
+
+    printf("kmpd: %d patterns, %d workers, listening on %s\n",
+           pattern_count, workers, socket_path);
+    fflush(stdout);
+
+    struct epoll_event events[KMPD_MAX_EVENTS];
+    while (!__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) {
+        int ready = epoll_wait(epoll_fd, events, KMPD_MAX_EVENTS, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < ready; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd) {
+                accept_connections(epoll_fd, listen_fd);
+            } else if (fd == wake_fd) {
+                deliver_responses(epoll_fd);
+            } else if (connections[fd].open) {
+                bool ok = true;
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    ok = false;
+                }
+                if (ok && (events[i].events & EPOLLOUT)) {
+                    ok = flush_connection(fd) && dispatch_frames(fd);
+                }
+                if (ok && (events[i].events & EPOLLIN)) {
+                    ok = read_connection(fd);
+                }
+                if (ok) {
+                    update_events(epoll_fd, fd);
+                } else {
+                    close_connection(epoll_fd, fd);
+                }
+            }
+        }
+    }
+
+    pthread_mutex_lock(&pending.lock);
+    pthread_cond_broadcast(&pending.ready);
+    pthread_mutex_unlock(&pending.lock);
+    for (int i = 0; i < workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    Job* leftover[2] = {queue_take_all(&pending), queue_take_all(&finished)};
+    for (int q = 0; q < 2; q++) {
+        while (leftover[q]) {
+            Job* next = leftover[q]->next;
+            free(leftover[q]->payload);
+            buffer_free(&leftover[q]->response);
+            free(leftover[q]);
+            leftover[q] = next;
+        }
+    }
+
+    for (int fd = 0; fd < KMPD_MAX_CONNECTIONS; fd++) {
+        if (connections[fd].open) {
+            close_connection(epoll_fd, fd);
+        }
+    }
+    close(listen_fd);
+    unlink(socket_path);
+
+    for (int i = 0; i < pattern_count; i++) {
+        kmp_destroy(patterns[i]);
+    }
+    free(patterns);
+    free(threads);
+
+    printf("kmpd: stopped\n");
+    return 0;
+}
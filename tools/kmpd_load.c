@@ -0,0 +1,234 @@
+#define _GNU_SOURCE
+#include "../include/kmp.h"
+#include "kmpd_proto.h"
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+typedef struct {
+    const char* socket_path;
+    int requests;
+    int texts_per_request;
+    int text_len;
+    unsigned int seed;
+    double* latencies;
+    int completed;
+    unsigned long long matches;
+} LoadWorker;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static bool write_all(int fd, const unsigned char* data, size_t len) {
+    while (len > 0) {
+        ssize_t sent = send(fd, data, len, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+static bool read_all(int fd, unsigned char* data, size_t len) {
+    while (len > 0) {
+        ssize_t received = recv(fd, data, len, 0);
+        if (received <= 0) {
+            if (received < 0 && errno == EINTR) continue;
+            return false;
+        }
+        data += received;
+        len -= received;
+    }
+    return true;
+}
+
+static int connect_socket(const char* path) {
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void* load_worker_main(void* arg) {
+    LoadWorker* worker = (LoadWorker*)arg;
+    int fd = connect_socket(worker->socket_path);
+    if (fd < 0) {
+        perror(worker->socket_path);
+        return NULL;
+    }
+
+    size_t payload_len = 8 + (size_t)worker->texts_per_request * (4 + worker->text_len);
+    unsigned char* request = (unsigned char*)malloc(4 + payload_len);
+    unsigned char* response = NULL;
+    size_t response_cap = 0;
+    if (!request) {
+        close(fd);
+        return NULL;
+    }
+
+    for (int r = 0; r < worker->requests; r++) {
+        unsigned char* p = request;
+        kmpd_put_u32(p, (uint32_t)payload_len);
+        kmpd_put_u32(p + 4, (uint32_t)r);
+        kmpd_put_u32(p + 8, (uint32_t)worker->texts_per_request);
+        p += 12;
+        for (int t = 0; t < worker->texts_per_request; t++) {
+            kmpd_put_u32(p, (uint32_t)worker->text_len);
+            p += 4;
+            for (int i = 0; i < worker->text_len; i++) {
+                p[i] = 'A' + rand_r(&worker->seed) % 26;
+            }
+            p += worker->text_len;
+        }
+
+        double start = now_ms();
+        unsigned char header[4];
+        if (!write_all(fd, request, 4 + payload_len) || !read_all(fd, header, 4)) {
+            break;
+        }
+
+        uint32_t len = kmpd_get_u32(header);
+        if (len > response_cap) {
+            unsigned char* grown = (unsigned char*)realloc(response, len);
+            if (!grown) break;
+            response = grown;
+            response_cap = len;
+        }
+        if (!read_all(fd, response, len)) {
+            break;
+        }
+        worker->latencies[worker->completed++] = now_ms() - start;
+
+        const unsigned char* q = response + 8;
+        uint32_t texts = kmpd_get_u32(response + 4);
+        for (uint32_t t = 0; t < texts && texts != KMPD_BAD_REQUEST; t++) {
+            uint32_t count = kmpd_get_u32(q);
+            worker->matches += count;
+            q += 4 + (size_t)count * 8;
+        }
+    }
+
+    free(request);
+    free(response);
+    close(fd);
+    return NULL;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void print_usage(const char* program_name) {
+    printf("Usage: %s [-s SOCKET] [-c CONNECTIONS] [-n REQUESTS] [-b TEXTS] [-l LENGTH]\n",
+           program_name);
+    printf("  -s SOCKET       Unix socket path (default %s)\n", KMPD_DEFAULT_SOCKET);
+    printf("  -c CONNECTIONS  Concurrent connections (default 8)\n");
+    printf("  -n REQUESTS     Requests per connection (default 1000)\n");
+    printf("  -b TEXTS        Texts per request (default 4)\n");
+    printf("  -l LENGTH       Bytes per text (default 256)\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* socket_path = KMPD_DEFAULT_SOCKET;
+    int connections = 8;
+    int requests = 1000;
+    int texts = 4;
+    int text_len = 256;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-s") == 0) {
+            socket_path = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "-c") == 0) {
+            connections = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-n") == 0) {
+            requests = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-b") == 0) {
+            texts = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-l") == 0) {
+            text_len = atoi(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "-h") == 0 ? 0 : 1;
+        }
+    }
+
+    if (connections < 1 || requests < 1 || texts < 0 || text_len < 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    LoadWorker* workers = (LoadWorker*)calloc(connections, sizeof(LoadWorker));
+    pthread_t* threads = (pthread_t*)malloc(connections * sizeof(pthread_t));
+    if (!workers || !threads) {
+        return 1;
+    }
+
+    double start = now_ms();
+    for (int i = 0; i < connections; i++) {
+        workers[i].socket_path = socket_path;
+        workers[i].requests = requests;
+        workers[i].texts_per_request = texts;
+        workers[i].text_len = text_len;
+        workers[i].seed = 12345u + i;
+        workers[i].latencies = (double*)malloc(requests * sizeof(double));
+        if (!workers[i].latencies) {
+            return 1;
+        }
+        pthread_create(&threads[i], NULL, load_worker_main, &workers[i]);
+    }
+
+    int total = 0;
+    unsigned long long matches = 0;
+    for (int i = 0; i < connections; i++) {
+        pthread_join(threads[i], NULL);
+        total += workers[i].completed;
+        matches += workers[i].matches;
+    }
+    double elapsed = now_ms() - start;
+
+    double* all = (double*)malloc((total ? total : 1) * sizeof(double));
+    if (!all) {
+        return 1;
+    }
+    int k = 0;
+    for (int i = 0; i < connections; i++) {
+        memcpy(all + k, workers[i].latencies, workers[i].completed * sizeof(double));
+        k += workers[i].completed;
+        free(workers[i].latencies);
+    }
+    qsort(all, total, sizeof(double), compare_double);
+
+    printf("=== kmpd load test ===\n");
+    printf("Connections: %d, texts/request: %d, bytes/text: %d\n",
+           connections, texts, text_len);
+    printf("Completed requests: %d (%llu matches)\n", total, matches);
+    if (total > 0) {
+        printf("Throughput: %.0f requests/sec\n", total / (elapsed / 1000.0));
+        printf("Latency p50: %.3f ms\n", all[(int)(total * 0.50)]);
+        printf("Latency p99: %.3f ms\n", all[(int)(total * 0.99) < total ? (int)(total * 0.99) : total - 1]);
+    }
+
+    free(all);
+    free(workers);
+    free(threads);
+    return total == connections * requests ? 0 : 1;
+}
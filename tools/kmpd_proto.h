@@ -0,0 +1,40 @@
+#ifndef KMPD_PROTO_H
+#define KMPD_PROTO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * kmpd wire format. All integers are unsigned 32-bit little-endian.
+ *
+ * Request frame:  u32 payload_len, then payload:
+ *                 u32 request_id, u32 text_count,
+ *                 text_count x (u32 text_len, text bytes)
+ *
+ * Response frame: u32 payload_len, then payload:
+ *                 u32 request_id, u32 text_count,
+ *                 text_count x (u32 match_count,
+ *                               match_count x (u32 pattern_index, u32 offset))
+ *
+ * Matches of one text are ordered by pattern index, then offset. A request
+ * that cannot be parsed, or that the daemon has no memory left to process,
+ * gets a response with text_count 0xFFFFFFFF.
+ */
+
+#define KMPD_DEFAULT_SOCKET "/tmp/kmpd.sock"
+#define KMPD_MAX_FRAME (64u * 1024u * 1024u)
+#define KMPD_BAD_REQUEST 0xFFFFFFFFu
+
+static inline void kmpd_put_u32(unsigned char* out, uint32_t value) {
+    out[0] = (unsigned char)(value & 0xFF);
+    out[1] = (unsigned char)((value >> 8) & 0xFF);
+    out[2] = (unsigned char)((value >> 16) & 0xFF);
+    out[3] = (unsigned char)((value >> 24) & 0xFF);
+}
+
+static inline uint32_t kmpd_get_u32(const unsigned char* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) |
+           ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+#endif